@@ -0,0 +1,45 @@
+#include "ActiveNotes.h"
+#include "PlaybackSnapshot.h"
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace
+{
+	int countTrailingZeros(juce::uint64 value)
+	{
+	#if defined(_MSC_VER)
+		unsigned long index;
+		_BitScanForward64(&index, value);
+		return (int)index;
+	#else
+		return __builtin_ctzll(value);
+	#endif
+	}
+}
+
+void ActiveNotes::clear()
+{
+	for (auto &channel : keys)
+	{
+		std::fill(std::begin(channel), std::end(channel), (juce::uint64)0);
+	}
+}
+
+void ActiveNotes::releaseAll(juce::MidiBuffer &buffer, int sampleOffset)
+{
+	for (int channel = 0; channel < NumChannels; ++channel)
+	{
+		for (int wordIndex = 0; wordIndex < NumWords; ++wordIndex)
+		{
+			auto word = keys[channel][wordIndex];
+			while (word != 0)
+			{
+				auto key = wordIndex * 64 + countTrailingZeros(word);
+				word &= word - 1;
+				addPackedMessage(buffer, (PackedMessage)(0x80 | channel) | ((PackedMessage)key << 8), sampleOffset);
+			}
+			keys[channel][wordIndex] = 0;
+		}
+	}
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include "NoteOffScheduler.h"
+
+/**
+ * The notes sounding on one midi output, one bit per channel and key.
+ * Kept up to date with every message that goes out, so a release sends
+ * note offs for exactly the sounding notes.
+ */
+class ActiveNotes
+{
+public:
+	typedef NoteOffScheduler::PackedMessage PackedMessage;
+	ActiveNotes() { clear(); }
+	/// a note on sets, a note off clears the bit of its key, any other message is ignored
+	void update(PackedMessage message)
+	{
+		auto status = message & 0xF0;
+		auto velocity = (message >> 16) & 0x7F;
+		auto key = (message >> 8) & 0x7F;
+		juce::uint64 isNoteOn = status == 0x90 && velocity != 0;
+		juce::uint64 isNoteOff = status == 0x80 || (status == 0x90 && velocity == 0);
+		auto bit = (juce::uint64)1 << (key & 63);
+		auto &word = keys[message & 0x0F][key >> 6];
+		word = (word | (bit & (0 - isNoteOn))) & ~(bit & (0 - isNoteOff));
+	}
+	/// sends a note off for every sounding note, O(active notes)
+	void releaseAll(juce::MidiBuffer &buffer, int sampleOffset);
+	void clear();
+private:
+	enum { NumChannels = 16, NumWords = 2 };
+	juce::uint64 keys[NumChannels][NumWords];
+};
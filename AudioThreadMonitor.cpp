@@ -0,0 +1,192 @@
+#include "AudioThreadMonitor.h"
+#include <algorithm>
+#include <sstream>
+#include <iomanip>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+	thread_local bool isInsideBlock = false;
+	std::atomic<int> allocationCount { 0 };
+}
+
+#ifdef WM_AUDIO_THREAD_CHECKS
+// debug only: counts every allocation made inside a block, see AudioThreadMonitor
+void* operator new(std::size_t size)
+{
+	if (isInsideBlock)
+	{
+		allocationCount.fetch_add(1, std::memory_order_relaxed);
+	}
+	auto memory = std::malloc(size == 0 ? 1 : size);
+	if (memory == nullptr)
+	{
+		throw std::bad_alloc();
+	}
+	return memory;
+}
+
+void* operator new[](std::size_t size)
+{
+	return operator new(size);
+}
+
+void operator delete(void* memory) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete[](void* memory, std::size_t) noexcept
+{
+	std::free(memory);
+}
+
+// over-aligned types, e.g. simd members, come through these
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+	if (isInsideBlock)
+	{
+		allocationCount.fetch_add(1, std::memory_order_relaxed);
+	}
+	auto alignmentInBytes = std::max((std::size_t)alignment, sizeof(void*));
+#if JUCE_WINDOWS
+	auto memory = _aligned_malloc(size == 0 ? 1 : size, alignmentInBytes);
+#else
+	void* memory = nullptr;
+	if (posix_memalign(&memory, alignmentInBytes, size == 0 ? 1 : size) != 0)
+	{
+		memory = nullptr;
+	}
+#endif
+	if (memory == nullptr)
+	{
+		throw std::bad_alloc();
+	}
+	return memory;
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+	return operator new(size, alignment);
+}
+
+void operator delete(void* memory, std::align_val_t) noexcept
+{
+#if JUCE_WINDOWS
+	_aligned_free(memory);
+#else
+	std::free(memory);
+#endif
+}
+
+void operator delete[](void* memory, std::align_val_t alignment) noexcept
+{
+	operator delete(memory, alignment);
+}
+
+void operator delete(void* memory, std::size_t, std::align_val_t alignment) noexcept
+{
+	operator delete(memory, alignment);
+}
+
+void operator delete[](void* memory, std::size_t, std::align_val_t alignment) noexcept
+{
+	operator delete(memory, alignment);
+}
+#endif
+
+bool AudioThreadMonitor::isChecking()
+{
+#ifdef WM_AUDIO_THREAD_CHECKS
+	return true;
+#else
+	return false;
+#endif
+}
+
+void AudioThreadMonitor::beginBlock()
+{
+	allocationsAtStart = allocationCount.load(std::memory_order_relaxed);
+	isInsideBlock = true;
+	blockStart = juce::Time::getHighResolutionTicks();
+}
+
+void AudioThreadMonitor::endBlock(BlockStats stats, int numSamples, double sampleRate)
+{
+	auto blockEnd = juce::Time::getHighResolutionTicks();
+	isInsideBlock = false;
+	stats.durationInSeconds = juce::Time::highResolutionTicksToSeconds(blockEnd - blockStart);
+	stats.bufferDurationInSeconds = sampleRate > 0 ? numSamples / sampleRate : 0;
+	stats.allocations = allocationCount.load(std::memory_order_relaxed) - allocationsAtStart;
+	int start1, size1, start2, size2;
+	fifo.prepareToWrite(1, start1, size1, start2, size2);
+	if (size1 == 0)
+	{
+		droppedBlocks.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+	records[(size_t)start1] = stats;
+	fifo.finishedWrite(1);
+}
+
+void AudioThreadMonitor::collect(Summary &summary)
+{
+	int start1, size1, start2, size2;
+	fifo.prepareToRead(fifo.getNumReady(), start1, size1, start2, size2);
+	auto addRecord = [&summary](const BlockStats &stats)
+	{
+		++summary.blocks;
+		auto load = stats.bufferDurationInSeconds > 0 ? stats.durationInSeconds / stats.bufferDurationInSeconds : 0;
+		auto bucket = std::min((size_t)(load * 10), (size_t)Summary::NumLoadBuckets - 1);
+		++summary.loadHistogram[bucket];
+		summary.overruns += load >= 1 ? 1 : 0;
+		summary.eventsEmitted += (juce::uint64)stats.eventsEmitted;
+		summary.tracksVisited += (juce::uint64)stats.tracksVisited;
+		summary.allocations += (juce::uint64)stats.allocations;
+		summary.maxNoteOffQueueDepth = std::max(summary.maxNoteOffQueueDepth, stats.noteOffQueueDepth);
+		summary.maxDurationInSeconds = std::max(summary.maxDurationInSeconds, stats.durationInSeconds);
+	};
+	for (int i = 0; i < size1; ++i)
+	{
+		addRecord(records[(size_t)(start1 + i)]);
+	}
+	for (int i = 0; i < size2; ++i)
+	{
+		addRecord(records[(size_t)(start2 + i)]);
+	}
+	fifo.finishedRead(size1 + size2);
+	summary.droppedBlocks = droppedBlocks.load(std::memory_order_relaxed);
+}
+
+std::string AudioThreadMonitor::Summary::toString() const
+{
+	std::stringstream ss;
+	ss << std::fixed << std::setprecision(3);
+	ss << "blocks: " << blocks
+		<< "  max: " << maxDurationInSeconds * 1000.0 << "ms"
+		<< "  overruns: " << overruns
+		<< "  events: " << eventsEmitted
+		<< "  tracks visited: " << tracksVisited
+		<< "  max note offs: " << maxNoteOffQueueDepth;
+	if (isChecking())
+	{
+		ss << "  allocations: " << allocations;
+	}
+	ss << "  load:";
+	for (const auto &count : loadHistogram)
+	{
+		ss << " " << count;
+	}
+	return ss.str();
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <array>
+#include <atomic>
+#include <string>
+
+/**
+ * Per block health data of processBlock(), handed from the audio thread
+ * to the editor through a single producer single consumer fifo.
+ * With WM_AUDIO_THREAD_CHECKS defined, heap allocations inside a block
+ * are counted as well. Locks are not: the plugin's own locks are never
+ * taken by the audio thread, and the ones inside juce or the host can not
+ * be seen from here.
+ */
+class AudioThreadMonitor
+{
+public:
+	struct BlockStats
+	{
+		double durationInSeconds = 0;
+		double bufferDurationInSeconds = 0;
+		int eventsEmitted = 0;
+		int tracksVisited = 0;
+		int noteOffQueueDepth = 0;
+		int allocations = 0;
+	};
+	/// the sum of all blocks collected by one consumer
+	struct Summary
+	{
+		/// block duration relative to the buffer duration: [0%, 10%), [10%, 20%) ... [90%, 100%), >= 100%
+		enum { NumLoadBuckets = 11 };
+		std::array<juce::uint64, NumLoadBuckets> loadHistogram {};
+		juce::uint64 blocks = 0;
+		juce::uint64 overruns = 0;
+		juce::uint64 droppedBlocks = 0;
+		juce::uint64 eventsEmitted = 0;
+		juce::uint64 tracksVisited = 0;
+		juce::uint64 allocations = 0;
+		int maxNoteOffQueueDepth = 0;
+		double maxDurationInSeconds = 0;
+		std::string toString() const;
+	};
+	/// audio thread
+	void beginBlock();
+	/// audio thread: `stats` without timing and check counters, they are added here
+	void endBlock(BlockStats stats, int numSamples, double sampleRate);
+	/// message thread: moves everything published so far into `summary`
+	void collect(Summary &summary);
+	static bool isChecking();
+private:
+	enum { FifoSize = 512 };
+	juce::AbstractFifo fifo { FifoSize };
+	std::array<BlockStats, FifoSize> records;
+	std::atomic<juce::uint64> droppedBlocks { 0 };
+	juce::int64 blockStart = 0;
+	int allocationsAtStart = 0;
+};
@@ -0,0 +1,222 @@
+#include "Base64.h"
+#include <juce_core/juce_core.h>
+#include <array>
+
+#if JUCE_INTEL
+#include <immintrin.h>
+#if JUCE_MSVC
+#define WM_TARGET(instructionSet)
+#else
+#define WM_TARGET(instructionSet) __attribute__((target(instructionSet)))
+#endif
+#endif
+
+namespace
+{
+	/// the simd paths store whole registers, the output has room for one beyond the end
+	const size_t OutputSlack = 32;
+	const signed char Invalid = -1;
+
+	typedef std::array<signed char, 256> DecodeTable;
+
+	DecodeTable createDecodeTable()
+	{
+		DecodeTable table;
+		table.fill(Invalid);
+		const char *alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+		for (signed char value = 0; value < 64; ++value)
+		{
+			table[(unsigned char)alphabet[(size_t)value]] = value;
+		}
+		return table;
+	}
+
+	const DecodeTable decodeTable = createDecodeTable();
+
+	/// decodes until the padding or the end, returns the number of bytes written or -1
+	long long decodeScalar(const unsigned char *input, size_t length, unsigned char *output)
+	{
+		auto out = output;
+		size_t i = 0;
+		for (; i + 4 <= length; i += 4)
+		{
+			auto a = decodeTable[input[i]];
+			auto b = decodeTable[input[i + 1]];
+			auto c = decodeTable[input[i + 2]];
+			auto d = decodeTable[input[i + 3]];
+			if ((a | b | c | d) < 0)
+			{
+				break;
+			}
+			auto quad = ((juce::uint32)a << 18) | ((juce::uint32)b << 12) | ((juce::uint32)c << 6) | (juce::uint32)d;
+			*out++ = (unsigned char)(quad >> 16);
+			*out++ = (unsigned char)(quad >> 8);
+			*out++ = (unsigned char)quad;
+		}
+		// the last quad, with or without padding
+		juce::uint32 bits = 0;
+		int numBits = 0;
+		for (; i < length && input[i] != '='; ++i)
+		{
+			auto value = decodeTable[input[i]];
+			if (value < 0)
+			{
+				return -1;
+			}
+			bits = (bits << 6) | (juce::uint32)value;
+			numBits += 6;
+			if (numBits >= 8)
+			{
+				numBits -= 8;
+				*out++ = (unsigned char)(bits >> numBits);
+			}
+		}
+		for (; i < length; ++i)
+		{
+			if (input[i] != '=')
+			{
+				return -1;
+			}
+		}
+		return out - output;
+	}
+
+#if JUCE_INTEL
+	/*
+	 * Classifies and translates 16 characters at once with nibble lookups,
+	 * then packs four 6 bit values into three bytes with multiply adds.
+	 * See Wojciech Muła and Daniel Lemire, "Faster Base64 Encoding and Decoding using AVX2 Instructions".
+	 * Both loops stop at the first character outside of the alphabet, the padding included,
+	 * and leave the rest to the scalar path.
+	 */
+	WM_TARGET("ssse3")
+	size_t decodeSsse3(const unsigned char *&input, size_t length, unsigned char *&output)
+	{
+		const __m128i lutLo = _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+		const __m128i lutHi = _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+		const __m128i lutRoll = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+		const __m128i mask2F = _mm_set1_epi8(0x2F);
+		const __m128i packPairs = _mm_set1_epi32(0x01400140);
+		const __m128i packQuads = _mm_set1_epi32(0x00011000);
+		const __m128i packBytes = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+		size_t consumed = 0;
+		while (length - consumed >= 16)
+		{
+			auto chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input));
+			auto hiNibbles = _mm_and_si128(_mm_srli_epi32(chars, 4), mask2F);
+			auto loNibbles = _mm_and_si128(chars, mask2F);
+			auto lo = _mm_shuffle_epi8(lutLo, loNibbles);
+			auto hi = _mm_shuffle_epi8(lutHi, hiNibbles);
+			if (_mm_movemask_epi8(_mm_cmpgt_epi8(_mm_and_si128(lo, hi), _mm_setzero_si128())) != 0)
+			{
+				break;
+			}
+			auto eq2F = _mm_cmpeq_epi8(chars, mask2F);
+			auto roll = _mm_shuffle_epi8(lutRoll, _mm_add_epi8(eq2F, hiNibbles));
+			auto values = _mm_add_epi8(chars, roll);
+			auto packed = _mm_madd_epi16(_mm_maddubs_epi16(values, packPairs), packQuads);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(output), _mm_shuffle_epi8(packed, packBytes));
+			input += 16;
+			output += 12;
+			consumed += 16;
+		}
+		return consumed;
+	}
+
+	WM_TARGET("avx2")
+	size_t decodeAvx2(const unsigned char *&input, size_t length, unsigned char *&output)
+	{
+		const __m256i lutLo = _mm256_setr_epi8(
+			0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A,
+			0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+		const __m256i lutHi = _mm256_setr_epi8(
+			0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+			0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+		const __m256i lutRoll = _mm256_setr_epi8(
+			0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+			0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+		const __m256i mask2F = _mm256_set1_epi8(0x2F);
+		const __m256i packPairs = _mm256_set1_epi32(0x01400140);
+		const __m256i packQuads = _mm256_set1_epi32(0x00011000);
+		const __m256i packBytes = _mm256_setr_epi8(
+			2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+			2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+		// joins the 12 bytes of both lanes
+		const __m256i packLanes = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, -1, -1);
+		size_t consumed = 0;
+		while (length - consumed >= 32)
+		{
+			auto chars = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input));
+			auto hiNibbles = _mm256_and_si256(_mm256_srli_epi32(chars, 4), mask2F);
+			auto loNibbles = _mm256_and_si256(chars, mask2F);
+			auto lo = _mm256_shuffle_epi8(lutLo, loNibbles);
+			auto hi = _mm256_shuffle_epi8(lutHi, hiNibbles);
+			if (!_mm256_testz_si256(lo, hi))
+			{
+				break;
+			}
+			auto eq2F = _mm256_cmpeq_epi8(chars, mask2F);
+			auto roll = _mm256_shuffle_epi8(lutRoll, _mm256_add_epi8(eq2F, hiNibbles));
+			auto values = _mm256_add_epi8(chars, roll);
+			auto packed = _mm256_madd_epi16(_mm256_maddubs_epi16(values, packPairs), packQuads);
+			packed = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(packed, packBytes), packLanes);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(output), packed);
+			input += 32;
+			output += 24;
+			consumed += 32;
+		}
+		return consumed;
+	}
+
+	enum class InstructionSet { Scalar, Ssse3, Avx2 };
+
+	InstructionSet detectInstructionSet()
+	{
+		if (juce::SystemStats::hasAVX2())
+		{
+			return InstructionSet::Avx2;
+		}
+		if (juce::SystemStats::hasSSSE3())
+		{
+			return InstructionSet::Ssse3;
+		}
+		return InstructionSet::Scalar;
+	}
+#endif
+}
+
+bool decodeBase64Scalar(const char *input, size_t length, std::vector<unsigned char> &output)
+{
+	output.resize(length / 4 * 3 + 3);
+	auto numBytes = decodeScalar(reinterpret_cast<const unsigned char*>(input), length, output.data());
+	output.resize(numBytes < 0 ? 0 : (size_t)numBytes);
+	return numBytes >= 0;
+}
+
+bool decodeBase64(const char *input, size_t length, std::vector<unsigned char> &output)
+{
+	output.resize(length / 4 * 3 + 3 + OutputSlack);
+	auto in = reinterpret_cast<const unsigned char*>(input);
+	auto out = output.data();
+#if JUCE_INTEL
+	static const InstructionSet instructionSet = detectInstructionSet();
+	if (instructionSet == InstructionSet::Avx2)
+	{
+		length -= decodeAvx2(in, length, out);
+	}
+	if (instructionSet != InstructionSet::Scalar)
+	{
+		// the rest of the avx2 loop still fills one sse register
+		length -= decodeSsse3(in, length, out);
+	}
+#endif
+	auto numBytes = decodeScalar(in, length, out);
+	if (numBytes < 0)
+	{
+		output.clear();
+		return false;
+	}
+	// shrinking keeps the storage, the caller gets the buffer the bytes were decoded into
+	output.resize((size_t)(out - output.data()) + (size_t)numBytes);
+	return true;
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * Decodes standard base64, padding is optional, straight into `output`.
+ * Returns false on characters outside of the alphabet, whitespace included.
+ * Uses AVX2 or SSSE3 if the cpu has it, the result is the same either way.
+ */
+bool decodeBase64(const char *input, size_t length, std::vector<unsigned char> &output);
+/// the portable path, decodeBase64() uses it for the tail
+bool decodeBase64Scalar(const char *input, size_t length, std::vector<unsigned char> &output);
@@ -0,0 +1,35 @@
+#include "CancelWatchdog.hpp"
+
+#define LOCK(mutex) std::unique_lock<Mutex> guard(mutex)
+
+const int CancelWatchdog::POLL_TIME = 10;
+
+CancelWatchdog::CancelWatchdog(const CancelCheck &isCancelled, const CancelHandler &onCancel) 
+	: thread(&CancelWatchdog::run, this, isCancelled, onCancel)
+{
+}
+
+CancelWatchdog::~CancelWatchdog()
+{
+	{
+		LOCK(mutex);
+		finished = true;
+	}
+	finishedCondition.notify_one();
+	thread.join();
+}
+
+void CancelWatchdog::run(const CancelCheck &isCancelled, const CancelHandler &onCancel)
+{
+	LOCK(mutex);
+	while (!finished)
+	{
+		if (isCancelled())
+		{
+			cancelled = true;
+			onCancel();
+			return;
+		}
+		finishedCondition.wait_for(guard, std::chrono::milliseconds(POLL_TIME));
+	}
+}
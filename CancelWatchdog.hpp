@@ -0,0 +1,32 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+/**
+ * Polls a cancel check on a thread of its own while the owner blocks,
+ * e.g. in a read from a pipe, and calls `onCancel` once it turned true.
+ * `onCancel` usually kills the process the owner is waiting for.
+ */
+class CancelWatchdog
+{
+public:
+	typedef std::function<bool()> CancelCheck;
+	typedef std::function<void()> CancelHandler;
+	CancelWatchdog(const CancelCheck &isCancelled, const CancelHandler &onCancel);
+	/// returns after the watchdog thread ended
+	~CancelWatchdog();
+	bool wasCancelled() const { return cancelled; }
+	static const int POLL_TIME;
+private:
+	typedef std::mutex Mutex;
+	Mutex mutex;
+	std::condition_variable finishedCondition;
+	bool finished = false;
+	std::atomic<bool> cancelled { false };
+	std::thread thread;
+	void run(const CancelCheck &isCancelled, const CancelHandler &onCancel);
+};
@@ -0,0 +1,93 @@
+#include "ChannelStates.h"
+#include "PlaybackSnapshot.h"
+
+namespace
+{
+	const int BankSelectMsb = 0;
+	const int BankSelectLsb = 32;
+	/// all sound off, reset all controllers, all notes off, ...: commands, not state
+	const int FirstChannelModeMessage = 120;
+
+	ChannelStates::PackedMessage packMessage(int status, int data1, int data2)
+	{
+		return (ChannelStates::PackedMessage)status | ((ChannelStates::PackedMessage)data1 << 8) | ((ChannelStates::PackedMessage)data2 << 16);
+	}
+}
+
+void ChannelStates::reset()
+{
+	for (auto &channel : channels)
+	{
+		channel.program = NotSet;
+		channel.pitchBend = NotSet;
+		std::fill(std::begin(channel.controllers), std::end(channel.controllers), NotSet);
+	}
+}
+
+bool ChannelStates::isStateMessage(PackedMessage message)
+{
+	switch (message & 0xF0)
+	{
+	case 0xB0:
+		return (int)((message >> 8) & 0x7F) < FirstChannelModeMessage;
+	case 0xC0:
+	case 0xE0:
+		return true;
+	default:
+		return false;
+	}
+}
+
+void ChannelStates::apply(PackedMessage message)
+{
+	if (!isStateMessage(message))
+	{
+		return;
+	}
+	auto &channel = channels[message & 0x0F];
+	auto data1 = (juce::int16)((message >> 8) & 0x7F);
+	auto data2 = (juce::int16)((message >> 16) & 0x7F);
+	switch (message & 0xF0)
+	{
+	case 0xB0:
+		channel.controllers[data1] = data2;
+		break;
+	case 0xC0:
+		channel.program = data1;
+		break;
+	case 0xE0:
+		channel.pitchBend = (juce::int16)(data1 | (data2 << 7));
+		break;
+	}
+}
+
+void ChannelStates::addTo(juce::MidiBuffer &buffer, int sampleOffset) const
+{
+	for (int channelIndex = 0; channelIndex < NumChannels; ++channelIndex)
+	{
+		const auto &channel = channels[channelIndex];
+		for (auto controller : { BankSelectMsb, BankSelectLsb })
+		{
+			if (channel.controllers[controller] != NotSet)
+			{
+				addPackedMessage(buffer, packMessage(0xB0 | channelIndex, controller, channel.controllers[controller]), sampleOffset);
+			}
+		}
+		if (channel.program != NotSet)
+		{
+			addPackedMessage(buffer, packMessage(0xC0 | channelIndex, channel.program, 0), sampleOffset);
+		}
+		for (int controller = 0; controller < NumControllers; ++controller)
+		{
+			if (controller == BankSelectMsb || controller == BankSelectLsb || channel.controllers[controller] == NotSet)
+			{
+				continue;
+			}
+			addPackedMessage(buffer, packMessage(0xB0 | channelIndex, controller, channel.controllers[controller]), sampleOffset);
+		}
+		if (channel.pitchBend != NotSet)
+		{
+			addPackedMessage(buffer, packMessage(0xE0 | channelIndex, channel.pitchBend & 0x7F, channel.pitchBend >> 7), sampleOffset);
+		}
+	}
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include "NoteOffScheduler.h"
+
+/**
+ * The program, controller and pitch bend state of the 16 midi channels,
+ * as far as it has been set by the events applied so far.
+ * Fixed size and trivially copyable, so it can be copied on the audio thread.
+ */
+class ChannelStates
+{
+public:
+	typedef NoteOffScheduler::PackedMessage PackedMessage;
+	enum { NumChannels = 16, NumControllers = 128 };
+	ChannelStates() { reset(); }
+	void reset();
+	/// updates the state if `message` is a program change, controller or pitch bend
+	void apply(PackedMessage message);
+	/// sends every value that has been set, bank selects before program changes
+	void addTo(juce::MidiBuffer &buffer, int sampleOffset) const;
+	/// true if `message` is a state change, i.e. apply() would change something
+	static bool isStateMessage(PackedMessage message);
+private:
+	static const juce::int16 NotSet = -1;
+	struct Channel
+	{
+		juce::int16 program;
+		juce::int16 pitchBend;
+		juce::int16 controllers[NumControllers];
+	};
+	Channel channels[NumChannels];
+};
@@ -0,0 +1,236 @@
+#include "CompileCache.h"
+
+namespace
+{
+    const char * WMConfigBasePath = "Werckmeister-VST";
+    const char * CacheDirectory = "compile-cache";
+    const int EntryMagic = 0x434d5757;
+    /// bump this if the entry layout or the compiler arguments change
+    const int FormatVersion = 2;
+
+    void writeString(juce::OutputStream &stream, const std::string &str)
+    {
+        stream.writeString(juce::String(str));
+    }
+
+    std::string readString(juce::InputStream &stream)
+    {
+        return stream.readString().toStdString();
+    }
+
+    void writeEventInfos(juce::OutputStream &stream, const EventTimeline &eventInfos)
+    {
+        stream.writeInt((int)eventInfos.iterative_size());
+        for (const auto &segment : eventInfos)
+        {
+            stream.writeDouble(boost::icl::lower(segment.first));
+            stream.writeDouble(boost::icl::upper(segment.first));
+            stream.writeInt((int)segment.second.size());
+            for (const auto &eventInfo : segment.second)
+            {
+                stream.writeDouble(eventInfo.beginTime);
+                stream.writeDouble(eventInfo.endTime);
+                stream.writeInt(eventInfo.beginPosition);
+                stream.writeInt(eventInfo.endPosition);
+                stream.writeInt((int)eventInfo.sourceId);
+            }
+        }
+    }
+
+    void readEventInfos(juce::InputStream &stream, EventTimeline &eventInfos)
+    {
+        auto numSegments = stream.readInt();
+        for (int segmentIndex = 0; segmentIndex < numSegments && !stream.isExhausted(); ++segmentIndex)
+        {
+            auto lower = stream.readDouble();
+            auto upper = stream.readDouble();
+            auto numEventInfos = stream.readInt();
+            EventPositionSet value;
+            for (int i = 0; i < numEventInfos; ++i)
+            {
+                DocumentEventInfo eventInfo;
+                eventInfo.beginTime = stream.readDouble();
+                eventInfo.endTime = stream.readDouble();
+                eventInfo.beginPosition = stream.readInt();
+                eventInfo.endPosition = stream.readInt();
+                eventInfo.sourceId = (unsigned)stream.readInt();
+                value.insert(eventInfo);
+            }
+            eventInfos += std::make_pair(TimelineIntervalType::right_open(lower, upper), value);
+        }
+    }
+}
+
+CompileCache::CompileCache(const std::string &compilerId_) : compilerId(compilerId_)
+{
+}
+
+juce::File CompileCache::getCacheDirectory()
+{
+    return juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+        .getChildFile(WMConfigBasePath)
+        .getChildFile(CacheDirectory);
+}
+
+juce::File CompileCache::getEntryFile(const std::string &sheetPath) const
+{
+    ContentHash hash;
+    hash.add(&FormatVersion, sizeof(FormatVersion));
+    hash.add(compilerId);
+    hash.add(sheetPath);
+    return getCacheDirectory().getChildFile(juce::String::toHexString((juce::int64)hash.getValue()) + ".wmc");
+}
+
+CompileCache::FileHashes CompileCache::hashFiles(const std::string &sheetPath, const std::vector<Source> &sources)
+{
+    std::vector<std::string> paths = { sheetPath };
+    for (const auto &source : sources)
+    {
+        paths.push_back(source.path);
+    }
+    FileHashes result;
+    for (const auto &path : paths)
+    {
+        ContentHash contentHash;
+        if (contentHash.addFile(juce::File(path)))
+        {
+            result[path] = contentHash.getValue();
+        }
+    }
+    return result;
+}
+
+bool CompileCache::hashSources(const std::string &sheetPath, const std::vector<Source> &sources, const FileHashes &fileHashes, Hash &hash)
+{
+    ContentHash contentHash;
+    std::vector<std::string> paths = { sheetPath };
+    for (const auto &source : sources)
+    {
+        paths.push_back(source.path);
+    }
+    for (const auto &path : paths)
+    {
+        auto fileHash = fileHashes.find(path);
+        if (fileHash == fileHashes.end())
+        {
+            return false;
+        }
+        contentHash.add(path);
+        contentHash.add(&fileHash->second, sizeof(fileHash->second));
+    }
+    hash = contentHash.getValue();
+    return true;
+}
+
+bool CompileCache::readEntryHeader(juce::InputStream &stream, const std::string &sheetPath, bool &hasHash, Hash &hash, std::vector<Source> &sources) const
+{
+    if (stream.readInt() != EntryMagic || stream.readInt() != FormatVersion)
+    {
+        return false;
+    }
+    hasHash = stream.readBool();
+    hash = (Hash)stream.readInt64();
+    if (readString(stream) != compilerId || readString(stream) != sheetPath)
+    {
+        return false;
+    }
+    auto numSources = stream.readInt();
+    for (int i = 0; i < numSources && !stream.isExhausted(); ++i)
+    {
+        Source source;
+        source.sourceId = readString(stream);
+        source.path = readString(stream);
+        sources.push_back(source);
+    }
+    return true;
+}
+
+CompileCache::FileHashes CompileCache::hashKnownSources(const std::string &sheetPath) const
+{
+    juce::FileInputStream stream(getEntryFile(sheetPath));
+    bool hasHash = false;
+    Hash storedHash = 0;
+    std::vector<Source> sources;
+    if (!stream.openedOk() || !readEntryHeader(stream, sheetPath, hasHash, storedHash, sources))
+    {
+        sources.clear();
+    }
+    return hashFiles(sheetPath, sources);
+}
+
+CompiledSheetPtr CompileCache::load(const std::string &sheetPath) const
+{
+    juce::FileInputStream stream(getEntryFile(sheetPath));
+    auto result = std::make_shared<CompiledSheet>();
+    bool hasHash = false;
+    Hash storedHash = 0;
+    if (!stream.openedOk() || !readEntryHeader(stream, sheetPath, hasHash, storedHash, result->sources) || !hasHash)
+    {
+        return nullptr;
+    }
+    Hash hash;
+    if (!hashSources(sheetPath, result->sources, hashFiles(sheetPath, result->sources), hash) || hash != storedHash)
+    {
+        return nullptr;
+    }
+    auto numMidiBytes = stream.readInt();
+    if (numMidiBytes <= 0)
+    {
+        return nullptr;
+    }
+    result->midiData.resize((size_t)numMidiBytes);
+    if (stream.read(result->midiData.data(), numMidiBytes) != numMidiBytes)
+    {
+        return nullptr;
+    }
+    readEventInfos(stream, result->eventInfos);
+    return result;
+}
+
+void CompileCache::store(const std::string &sheetPath, const CompiledSheet &sheet, const FileHashes &hashesBeforeCompile) const
+{
+    if (sheet.midiData.empty())
+    {
+        return;
+    }
+    // a source first seen in this compile may have changed meanwhile, there is no hash from before
+    Hash hash = 0;
+    bool hasHash = hashSources(sheetPath, sheet.sources, hashesBeforeCompile, hash);
+    auto entryFile = getEntryFile(sheetPath);
+    if (entryFile.getParentDirectory().createDirectory().failed())
+    {
+        return;
+    }
+    juce::TemporaryFile temporaryFile(entryFile);
+    {
+        juce::FileOutputStream stream(temporaryFile.getFile());
+        if (!stream.openedOk())
+        {
+            return;
+        }
+        stream.writeInt(EntryMagic);
+        stream.writeInt(FormatVersion);
+        stream.writeBool(hasHash);
+        stream.writeInt64((juce::int64)hash);
+        writeString(stream, compilerId);
+        writeString(stream, sheetPath);
+        stream.writeInt((int)sheet.sources.size());
+        for (const auto &source : sheet.sources)
+        {
+            writeString(stream, source.sourceId);
+            writeString(stream, source.path);
+        }
+        if (hasHash)
+        {
+            stream.writeInt((int)sheet.midiData.size());
+            stream.write(sheet.midiData.data(), sheet.midiData.size());
+            writeEventInfos(stream, sheet.eventInfos);
+        }
+        stream.flush();
+        if (stream.getStatus().failed())
+        {
+            return;
+        }
+    }
+    temporaryFile.overwriteTargetFileWithTemporary();
+}
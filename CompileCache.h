@@ -0,0 +1,45 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "CompiledSheet.h"
+#include "ContentHash.h"
+
+/**
+ * Compiled sheets kept on disk, so a sheet whose sources did not change
+ * since its last compile is loaded without starting the compiler.
+ * An entry is found by the sheet path and the compiler, and it is only used
+ * while the content of every source file still hashes to the stored value.
+ * That value is taken from the files as they were before the compile, an edit
+ * made while the compiler runs never ends up in an entry.
+ * Entries are written to a temporary file first, so instances sharing the
+ * cache never read a partial entry.
+ */
+class CompileCache
+{
+public:
+    typedef ContentHash::Value Hash;
+    /// content hash per file path
+    typedef std::unordered_map<std::string, Hash> FileHashes;
+    /// `compilerId` names the compiler executable and its version
+    CompileCache(const std::string &compilerId);
+    /// null if there is no entry or a source changed since it was stored
+    CompiledSheetPtr load(const std::string &sheetPath) const;
+    /// call before compiling: hashes the sheet and the sources its last entry knows of
+    FileHashes hashKnownSources(const std::string &sheetPath) const;
+    /// `hashesBeforeCompile` from hashKnownSources(). If the compile found a source
+    /// which was not hashed before, the entry only keeps the sources for the next compile
+    void store(const std::string &sheetPath, const CompiledSheet &sheet, const FileHashes &hashesBeforeCompile) const;
+    static juce::File getCacheDirectory();
+private:
+    std::string compilerId;
+    juce::File getEntryFile(const std::string &sheetPath) const;
+    /// reads an entry up to its sources, false if it does not belong to `sheetPath`
+    bool readEntryHeader(juce::InputStream &stream, const std::string &sheetPath, bool &hasHash, Hash &hash, std::vector<Source> &sources) const;
+    /// the files which can not be read are left out
+    static FileHashes hashFiles(const std::string &sheetPath, const std::vector<Source> &sources);
+    /// combines the hashes of the sheet and its sources, false if one of them is missing
+    static bool hashSources(const std::string &sheetPath, const std::vector<Source> &sources, const FileHashes &fileHashes, Hash &hash);
+};
@@ -0,0 +1,97 @@
+#include "CompileLock.h"
+#include <boost/functional/hash.hpp>
+#include <juce_core/juce_core.h>
+#include "CompileCache.h"
+
+#if JUCE_WINDOWS
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+#endif
+
+const int CompileLock::WAIT_SLICE_TIME = 50;
+
+CompileLock::CompileLock(const std::string &compilerId, const std::string &sheetPath)
+{
+    std::size_t lockId = 0;
+    boost::hash_combine(lockId, compilerId);
+    boost::hash_combine(lockId, sheetPath);
+    _lockFile = CompileCache::getCacheDirectory().getChildFile("wm-compile-" + juce::String(std::to_string(lockId)) + ".lock");
+    _lockFile.getParentDirectory().createDirectory();
+    // if the file can't be opened, e.g. in a sandboxed host, every process compiles on its own
+#if JUCE_WINDOWS
+    auto handle = CreateFileW(_lockFile.getFullPathName().toWideCharPointer(), GENERIC_READ | GENERIC_WRITE,
+        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    _fileHandle = handle == INVALID_HANDLE_VALUE ? nullptr : handle;
+#else
+    // not inherited by the compiler processes, they would keep the lock alive otherwise
+    _fileDescriptor = ::open(_lockFile.getFullPathName().toRawUTF8(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+#endif
+}
+
+CompileLock::~CompileLock()
+{
+    if (_isOwner)
+    {
+        unlock();
+    }
+#if JUCE_WINDOWS
+    if (_fileHandle != nullptr)
+    {
+        CloseHandle(_fileHandle);
+    }
+#else
+    if (_fileDescriptor >= 0)
+    {
+        ::close(_fileDescriptor);
+    }
+#endif
+}
+
+bool CompileLock::isOpen() const
+{
+#if JUCE_WINDOWS
+    return _fileHandle != nullptr;
+#else
+    return _fileDescriptor >= 0;
+#endif
+}
+
+bool CompileLock::tryLock()
+{
+#if JUCE_WINDOWS
+    OVERLAPPED overlapped = {};
+    return LockFileEx(_fileHandle, LOCKFILE_EXCLUSIVE_LOCK | LOCKFILE_FAIL_IMMEDIATELY, 0, 1, 0, &overlapped) != FALSE;
+#else
+    // flock, not fcntl: fcntl locks are per process and would let instances in the same host through
+    return ::flock(_fileDescriptor, LOCK_EX | LOCK_NB) == 0;
+#endif
+}
+
+void CompileLock::unlock()
+{
+#if JUCE_WINDOWS
+    OVERLAPPED overlapped = {};
+    UnlockFileEx(_fileHandle, 0, 1, 0, &overlapped);
+#else
+    ::flock(_fileDescriptor, LOCK_UN);
+#endif
+}
+
+bool CompileLock::acquire(const CancelCheck &isCancelled)
+{
+    if (!isOpen())
+    {
+        return false;
+    }
+    _isOwner = tryLock();
+    while (!_isOwner && !isCancelled())
+    {
+        _hadToWait = true;
+        juce::Thread::sleep(WAIT_SLICE_TIME);
+        _isOwner = tryLock();
+    }
+    return _isOwner;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <juce_core/juce_core.h>
+
+/**
+ * Lets only one process on this machine compile a sheet at a time.
+ * The process holding the lock compiles and stores the result in the
+ * CompileCache, processes which had to wait find it there afterwards.
+ * The lock is an exclusive lock on a file next to the cache entries,
+ * the system releases it when its owner exits or crashes.
+ */
+class CompileLock
+{
+public:
+    typedef std::function<bool()> CancelCheck;
+    CompileLock(const std::string &compilerId, const std::string &sheetPath);
+    ~CompileLock();
+    /// waits until no other process compiles the sheet.
+    /// false if cancelled or the lock is not available, the caller compiles anyway then
+    bool acquire(const CancelCheck &isCancelled);
+    /// another process compiled the sheet meanwhile, its result is worth a look
+    bool hadToWait() const { return _hadToWait; }
+    /// a waiting process checks for cancellation that often
+    static const int WAIT_SLICE_TIME;
+private:
+    /// the lock file stays, removing it would let a waiting process lock a file nobody else sees
+    juce::File _lockFile;
+#if JUCE_WINDOWS
+    void *_fileHandle = nullptr;
+#else
+    int _fileDescriptor = -1;
+#endif
+    bool isOpen() const;
+    bool tryLock();
+    void unlock();
+    bool _isOwner = false;
+    bool _hadToWait = false;
+};
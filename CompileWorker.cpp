@@ -0,0 +1,89 @@
+#include "CompileWorker.hpp"
+
+
+#define LOCK(mutex) std::lock_guard<Mutex> guard(mutex)
+
+
+const int CompileWorker::SETTLE_TIME = 100;
+const int CompileWorker::THREAD_IDLE_TIME = 50;
+
+CompileWorker::CompileWorker() : Thread("Compile Worker Thread")
+{
+}
+
+CompileWorker::~CompileWorker()
+{
+	stopThread(THREAD_IDLE_TIME * 100);
+}
+
+void CompileWorker::requestCompile(const Request& request)
+{
+	{
+		LOCK(mutex);
+		pendingRequest = request;
+		hasPendingRequest = true;
+		lastRequestTime = juce::Time::getMillisecondCounter();
+		requestGeneration.fetch_add(1);
+	}
+	notify();
+}
+
+void CompileWorker::post(Task task)
+{
+	{
+		LOCK(mutex);
+		tasks.push_back(std::move(task));
+	}
+	notify();
+}
+
+void CompileWorker::runTasks()
+{
+	Tasks tasksToRun;
+	{
+		LOCK(mutex);
+		tasksToRun.swap(tasks);
+	}
+	for (auto& task : tasksToRun)
+	{
+		task();
+	}
+}
+
+bool CompileWorker::takeRequest(Request& request, juce::uint64& generation)
+{
+	LOCK(mutex);
+	if (!hasPendingRequest)
+	{
+		return false;
+	}
+	if (juce::Time::getMillisecondCounter() - lastRequestTime < (juce::uint32)SETTLE_TIME)
+	{
+		return false;
+	}
+	request = pendingRequest;
+	hasPendingRequest = false;
+	generation = requestGeneration.load();
+	return true;
+}
+
+void CompileWorker::run()
+{
+	juce::Thread::setPriority(juce::Thread::Priority::background);
+	while (!threadShouldExit())
+	{
+		runTasks();
+		Request request;
+		juce::uint64 generation = 0;
+		if (!takeRequest(request, generation))
+		{
+			wait(THREAD_IDLE_TIME);
+			continue;
+		}
+		auto isCancelled = [this, generation]()
+		{
+			return threadShouldExit() || requestGeneration.load() != generation;
+		};
+		onCompile(request, isCancelled);
+	}
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+
+/**
+ * Runs sheet compilations on a background thread, one at a time.
+ * Requests arriving in a burst (e.g. an editor saving several files)
+ * are coalesced into one compile of the latest request, and a running
+ * compile is cancelled as soon as a newer request comes in.
+ */
+class CompileWorker : public juce::Thread
+{
+public:
+	typedef std::function<bool()> CancelCheck;
+	struct Request
+	{
+		std::string sheetPath;
+		/// keep watching the sheet file even if it does not compile
+		bool watchSheetOnFailure = false;
+	};
+	typedef std::function<void(const Request&, const CancelCheck&)> CompileHandler;
+	typedef std::function<void()> Task;
+	CompileWorker();
+	~CompileWorker() override;
+	/// runs on the worker thread; has to return soon after `isCancelled()` turned true
+	CompileHandler onCompile = [](const Request&, const CancelCheck&){};
+	/// any thread: replaces a pending request and cancels the running one
+	void requestCompile(const Request& request);
+	/// any thread: runs `task` on the worker thread before the next compile
+	void post(Task task);
+	void run() override;
+	/// a request waits until no newer one came in for this long
+	static const int SETTLE_TIME;
+	static const int THREAD_IDLE_TIME;
+private:
+	typedef std::mutex Mutex;
+	typedef std::deque<Task> Tasks;
+	Mutex mutex;
+	Tasks tasks;
+	Request pendingRequest;
+	bool hasPendingRequest = false;
+	juce::uint32 lastRequestTime = 0;
+	std::atomic<juce::uint64> requestGeneration { 0 };
+	void runTasks();
+	/// false if there is no request or the last one is not settled yet
+	bool takeRequest(Request& request, juce::uint64& generation);
+};
@@ -9,21 +9,11 @@
 #include <vector>
 #include <sstream>
 #include "PreferencesData.h"
+#include "CompilerBackend.h"
+#include "CompilerRegistry.h"
+#include "CompilerOutputParser.h"
 
 
-#if WIN32
-#define Popen _popen
-#define PClose _pclose
-#else
-#define Popen popen
-#define PClose pclose
-#endif
-
-namespace
-{
-    std::string __compiler_executable;
-}
-
 namespace
 {
     class CompilerException : public std::exception {
@@ -36,115 +26,77 @@ namespace
     private:
         const std::string _what;
     };
-    std::string exec(const std::string & cmd, const std::vector<std::string> &arguments) {
-        std::stringstream ss;
-        ss << cmd;
-        for (auto const& arg : arguments)
-        {
-            ss << " " << arg;
-        }
-
-        std::array<char, 128> buffer;
-        std::string result;
-        std::unique_ptr<FILE, decltype(&PClose)> pipe(Popen(ss.str().c_str(), "r"), PClose);
-        if (!pipe) 
-        {
-            throw std::runtime_error("popen() failed!");
-        }
-        while (fgets(buffer.data(), buffer.size(), pipe.get()) != nullptr) 
+    /// the compiler leaves `midiData` out of the json if it wrote the midi file itself
+    void readMidiFile(const juce::File &midiFile, std::vector<unsigned char> &midiData)
+    {
+        juce::FileInputStream stream(midiFile);
+        auto numBytes = stream.openedOk() ? stream.getTotalLength() : 0;
+        if (numBytes <= 0)
         {
-            result += buffer.data();
+            throw std::runtime_error("the compiler delivered no midi data");
         }
-        return result.substr(0, result.length() - 1);
-    }
-
-    const juce::var & get(const juce::var &json, const std::string &key, bool expected = true) 
-    {
-        auto &result = json[key.c_str()];
-        if (expected && result.isVoid())
+        midiData.resize((size_t)numBytes);
+        if (stream.read(midiData.data(), (int)numBytes) != (int)numBytes)
         {
-            throw std::runtime_error("unexpected compiler response");
+            throw std::runtime_error("could not read the midi data");
         }
-        return result;
     }
 
-    void checkForErrors(const juce::var& jsonResult, const std::string &, const std::string&)
+    void checkForErrors(const CompilerOutputParser &parser)
     {
-        const auto& errorMessage = get(jsonResult, "errorMessage", false);
-        if (errorMessage.isVoid())
+        if (parser.hasError())
         {
-            return;
+            throw CompilerException(parser.getErrorMessage());
         }
-        const auto& sourceFile = get(jsonResult, "sourceFile", false);
-        const auto& position = get(jsonResult, "positionBegin", false);
-        std::stringstream ss;
-        if (!sourceFile.isVoid())
+        if (!parser.isComplete())
         {
-            ss << "in file \""<< sourceFile.toString() << "\"";
-        }
-        if (!position.isVoid())
-        {
-            ss << ": position " << position.toString();
+            throw std::runtime_error("unexpected compiler response");
         }
-        ss << "\n" << errorMessage.toString();
-        throw CompilerException(ss.str());
     }
 }
 
 
-CompiledSheetPtr Compiler::compile(const std::string& sheetPath)
+CompiledSheetPtr Compiler::compile(const std::string& sheetPath, const CancelCheck &isCancelled)
 {
-    auto compilerExe = compilerExecutable();
+    auto compiler = CompilerRegistry::getInstance().getCompiler();
     logger.log(LogLambda(log << "sheetc" << " \"" << sheetPath << "\""));
     try 
     {
         CompiledSheetPtr result = std::make_shared<CompiledSheet>();
-        auto stringResult = exec(compilerExe, { sheetPath, "--mode=json" });
-        auto jsonResult = juce::JSON::parse(stringResult);
-        checkForErrors(jsonResult, compilerExe, sheetPath);
-        const auto& midiInfo = get(jsonResult, "midi");
-        // midi data
-        const auto base64MidiData = get(midiInfo, "midiData").toString();
-        double estimatedByteSize = (base64MidiData.length() * (3.0 / 4.0) + 10);
-        juce::MemoryOutputStream midiByteStream((size_t)estimatedByteSize);
-        juce::Base64::convertFromBase64(midiByteStream, base64MidiData);
-        result->midiData.resize(midiByteStream.getDataSize());
-        ::memcpy(result->midiData.data(), midiByteStream.getData(), result->midiData.size());
-        logger.log(LogLambda(log << "MIDI data created: " << result->midiData.size() << " Bytes"));
-        // sources
-        const auto& sources = get(midiInfo, "sources");
-        for (int i = 0; i < sources.size(); ++i)
+        juce::TemporaryFile midiFile(".mid");
+        // older compilers ignore --output in json mode or reject it, they get the original invocation
+        auto midiFilePath = compiler.writesMidiFile ? midiFile.getFile().getFullPathName().toStdString() : std::string();
+        // the sheet is filled while the compiler output arrives, there is no json tree
+        CompilerOutputParser parser(*result);
+        auto onOutput = [&parser](const char *data, size_t numBytes) { parser.feed(data, numBytes); };
+        try
         {
-            const auto& sourceId = get(sources[i], "sourceId");
-            const auto& path = get(sources[i], "path");
-            result->sources.push_back({ sourceId.toString().toStdString(), path.toString().toStdString() });
+            getCompilerBackend(compiler.executable)->compile(sheetPath, midiFilePath, onOutput, isCancelled);
         }
-        // document event infos
-        const auto& eventInfos = get(jsonResult, "eventInfos");
-        for (int i = 0; i < eventInfos.size(); ++i)
+        catch (const CompilerProcessFailed &ex)
         {
-            const auto& sheetEventInfos = get(eventInfos[i], "sheetEventInfos");
-            for(int j = 0; j < sheetEventInfos.size(); ++j)
+            // a failed compile still reports its error as a json document
+            parser.finish();
+            if (ex.exitStatus.hasCrashed || !parser.hasError())
             {
-                DocumentEventInfo docEventInfo;
-                const auto &sheetEventInfo = sheetEventInfos[j];
-                docEventInfo.sourceId = (juce::int64)get(sheetEventInfo, "sourceId");
-                docEventInfo.beginPosition = (juce::int64)get(sheetEventInfo, "beginPosition");
-                auto endp = get(sheetEventInfo, "endPosition", false);
-                if (!endp.isVoid()) 
-                {
-                    docEventInfo.endPosition = (juce::int64)get(sheetEventInfo, "endPosition", false);
-                } else {
-                    docEventInfo.beginPosition;
-                }
-                docEventInfo.beginTime = (double)get(sheetEventInfo, "beginTime");
-                docEventInfo.endTime = (double)get(sheetEventInfo, "endTime");
-                EventPositionSet value = {docEventInfo};
-                result->eventInfos += std::make_pair(TimelineIntervalType::right_open(docEventInfo.beginTime, docEventInfo.endTime), value);
+                throw;
             }
+            auto errorOutput = juce::String(ex.errorOutput).trim().toStdString();
+            throw CompilerException(errorOutput.empty() ? parser.getErrorMessage() : parser.getErrorMessage() + "\n" + errorOutput);
+        }
+        parser.finish();
+        checkForErrors(parser);
+        if (result->midiData.empty())
+        {
+            readMidiFile(midiFile.getFile(), result->midiData);
         }
+        logger.log(LogLambda(log << "MIDI data created: " << result->midiData.size() << " Bytes"));
         return result;
     }
+    catch (const CompileCancelled&)
+    {
+        logger.info(LogLambda(log << "compile of \"" << sheetPath << "\" cancelled"));
+    }
     catch (const CompilerException& ex)
     {
         logger.error(LogLambda(log << ex.what()));
@@ -163,33 +115,10 @@ CompiledSheetPtr Compiler::compile(const std::string& sheetPath)
 
 std::string Compiler::getVersionStr()
 {
-    return exec(compilerExecutable(), {"--version"});
+    return CompilerRegistry::getInstance().getCompiler().version;
 }
 
 std::string Compiler::compilerExecutable() const
 {
-    if (__compiler_executable.empty())
-    {
-        auto preferencesData = readPreferencesData();
-        if (!preferencesData.binPath.empty())
-        {
-            __compiler_executable = (juce::File::addTrailingSeparator(preferencesData.binPath) + "sheetc").toStdString();
-            return __compiler_executable;
-        }
-#ifdef WIN32
-        __compiler_executable = "sheetc";
-#else
-        __compiler_executable = exec("which", {"sheetc"});
-        if (__compiler_executable.empty())
-        {
-            __compiler_executable = "/usr/local/bin/sheetc";
-        }
-#endif
-    }
-    return __compiler_executable;
+    return CompilerRegistry::getInstance().getCompiler().executable;
 }
-
-void Compiler::resetExecutablePath()
-{
-    __compiler_executable.clear();
-}
\ No newline at end of file
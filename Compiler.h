@@ -2,17 +2,20 @@
 
 #include <string>
 #include <vector>
+#include <functional>
 #include "ILogger.h"
 #include "CompiledSheet.h"
 
 class Compiler 
 {
 public:
+    typedef std::function<bool()> CancelCheck;
     Compiler(ILogger &logger_) : logger(logger_) {}
-    CompiledSheetPtr compile(const std::string &sheetPath);
+    /// returns null on errors and if `isCancelled` turned true while compiling
+    CompiledSheetPtr compile(const std::string &sheetPath, const CancelCheck &isCancelled = [](){ return false; });
+    /// see CompilerRegistry, the compiler is run only if it changed
     std::string getVersionStr();
     std::string compilerExecutable() const;
-    void resetExecutablePath();
 private:
     ILogger& logger;
     
@@ -0,0 +1,183 @@
+#include "CompilerBackend.h"
+#include "CancelWatchdog.hpp"
+#include "PreferencesData.h"
+#include "Subprocess.hpp"
+#include <juce_core/juce_core.h>
+#include <algorithm>
+#include <chrono>
+#include <map>
+
+#define LOCK(mutex) std::lock_guard<Mutex> guard(mutex)
+
+namespace
+{
+    const size_t MaxFrameHeaderSize = 20;
+
+    std::string describeFailure(const WorkerProcess::ExitStatus &exitStatus, const std::string &errorOutput)
+    {
+        std::string result = exitStatus.hasCrashed 
+            ? "the compiler crashed" 
+            : "the compiler exited with code " + std::to_string(exitStatus.exitCode);
+        auto message = juce::String(errorOutput).trim();
+        if (message.isNotEmpty())
+        {
+            result += ": " + message.toStdString();
+        }
+        return result;
+    }
+}
+
+CompilerProcessFailed::CompilerProcessFailed(const WorkerProcess::ExitStatus &exitStatus_, const std::string &errorOutput_)
+    : std::runtime_error(describeFailure(exitStatus_, errorOutput_)), exitStatus(exitStatus_), errorOutput(errorOutput_)
+{
+}
+
+const size_t WorkerCompilerBackend::MaxResponseSize = 1024 * 1024 * 1024;
+const size_t WorkerCompilerBackend::READ_CHUNK_SIZE = 64 * 1024;
+const int WorkerCompilerBackend::WAIT_SLICE_TIME = 50;
+
+OneShotCompilerBackend::OneShotCompilerBackend(const std::string &compilerExecutable_) 
+    : compilerExecutable(compilerExecutable_)
+{
+}
+
+void OneShotCompilerBackend::compile(const std::string &sheetPath, const std::string &midiFilePath, const OutputHandler &onOutput, const CancelCheck &isCancelled)
+{
+    Subprocess::Arguments arguments = { sheetPath, "--mode=json" };
+    if (!midiFilePath.empty())
+    {
+        arguments.push_back("--output=" + midiFilePath);
+    }
+    Subprocess process(compilerExecutable, arguments);
+    if (!process.isStarted())
+    {
+        throw std::runtime_error("could not start " + compilerExecutable);
+    }
+    if (!process.readOutput(onOutput, isCancelled))
+    {
+        throw CompileCancelled();
+    }
+    const auto &exitStatus = process.getExitStatus();
+    if (exitStatus.hasCrashed || exitStatus.exitCode != 0)
+    {
+        throw CompilerProcessFailed(exitStatus, process.getErrorOutput());
+    }
+}
+
+WorkerCompilerBackend::WorkerCompilerBackend(const WorkerProcess::CommandLine &commandLine_) 
+    : commandLine(commandLine_)
+{
+}
+
+void WorkerCompilerBackend::compile(const std::string &sheetPath, const std::string &midiFilePath, const OutputHandler &onOutput, const CancelCheck &isCancelled)
+{
+    // another plugin instance may be compiling, a cancelled request must not wait for it
+    std::unique_lock<Mutex> guard(mutex, std::defer_lock);
+    while (!guard.try_lock_for(std::chrono::milliseconds(WAIT_SLICE_TIME)))
+    {
+        if (isCancelled())
+        {
+            throw CompileCancelled();
+        }
+    }
+    if (!process || !process->isRunning())
+    {
+        process = std::make_unique<WorkerProcess>();
+        if (!process->start(commandLine))
+        {
+            process.reset();
+            throw std::runtime_error("could not start the compiler worker " + commandLine.front());
+        }
+    }
+    juce::DynamicObject::Ptr request = new juce::DynamicObject();
+    request->setProperty("sheetPath", juce::String(sheetPath));
+    if (!midiFilePath.empty())
+    {
+        request->setProperty("output", juce::String(midiFilePath));
+    }
+    auto payload = juce::JSON::toString(juce::var(request.get()), true).toStdString();
+    auto frame = std::to_string(payload.size()) + "\n" + payload;
+    bool succeeded = false;
+    bool cancelled = false;
+    try
+    {
+        CancelWatchdog watchdog(isCancelled, [this]() { process->kill(); });
+        succeeded = process->write(frame.data(), frame.size()) && readResponse(onOutput);
+        cancelled = watchdog.wasCancelled();
+    }
+    catch (...)
+    {
+        // the rest of the response is still in the pipe
+        process.reset();
+        throw;
+    }
+    if (cancelled)
+    {
+        process.reset();
+        throw CompileCancelled();
+    }
+    if (!succeeded)
+    {
+        process.reset();
+        throw std::runtime_error("the compiler worker stopped unexpectedly");
+    }
+}
+
+bool WorkerCompilerBackend::readResponse(const OutputHandler &onOutput)
+{
+    size_t size = 0;
+    char ch = 0;
+    for (size_t i = 0; ; ++i)
+    {
+        if (i > MaxFrameHeaderSize || !process->readExactly(&ch, 1))
+        {
+            return false;
+        }
+        if (ch == '\n')
+        {
+            break;
+        }
+        if (ch < '0' || ch > '9')
+        {
+            return false;
+        }
+        size = size * 10 + (size_t)(ch - '0');
+    }
+    if (size > MaxResponseSize)
+    {
+        return false;
+    }
+    buffer.resize(READ_CHUNK_SIZE);
+    while (size > 0)
+    {
+        auto chunkSize = std::min(size, READ_CHUNK_SIZE);
+        if (!process->readExactly(buffer.data(), chunkSize))
+        {
+            return false;
+        }
+        onOutput(buffer.data(), chunkSize);
+        size -= chunkSize;
+    }
+    return true;
+}
+
+CompilerBackendPtr getCompilerBackend(const std::string &compilerExecutable)
+{
+    typedef std::mutex Mutex;
+    typedef std::map<WorkerProcess::CommandLine, CompilerBackendPtr> Workers;
+    static Mutex mutex;
+    static Workers workers;
+    auto workerPath = readPreferencesData().compilerWorkerPath;
+    if (workerPath.empty())
+    {
+        return std::make_shared<OneShotCompilerBackend>(compilerExecutable);
+    }
+    WorkerProcess::CommandLine commandLine = { workerPath, compilerExecutable };
+    LOCK(mutex);
+    auto &worker = workers[commandLine];
+    if (!worker)
+    {
+        worker = std::make_shared<WorkerCompilerBackend>(commandLine);
+    }
+    return worker;
+}
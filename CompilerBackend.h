@@ -0,0 +1,86 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "WorkerProcess.hpp"
+
+/**
+ * Runs the werckmeister compiler and passes on the json document of a
+ * compile while it arrives, see CompilerOutputParser.
+ */
+class CompilerBackend
+{
+public:
+    typedef std::function<bool()> CancelCheck;
+    /// called for every chunk of the json document
+    typedef std::function<void(const char *data, size_t numBytes)> OutputHandler;
+    virtual ~CompilerBackend() = default;
+    /// the compiler writes the midi data to `midiFilePath`, an empty path keeps it in the json.
+    /// throws CompileCancelled if `isCancelled()` turned true and std::exception on errors
+    virtual void compile(const std::string &sheetPath, const std::string &midiFilePath, const OutputHandler &onOutput, const CancelCheck &isCancelled) = 0;
+};
+typedef std::shared_ptr<CompilerBackend> CompilerBackendPtr;
+
+class CompileCancelled : public std::exception {
+public:
+    virtual const char* what() const throw()
+    {
+        return "cancelled";
+    }
+};
+
+/// the compiler crashed or exited with an error code
+class CompilerProcessFailed : public std::runtime_error
+{
+public:
+    CompilerProcessFailed(const WorkerProcess::ExitStatus &exitStatus, const std::string &errorOutput);
+    const WorkerProcess::ExitStatus exitStatus;
+    /// what the compiler wrote to stderr
+    const std::string errorOutput;
+};
+
+/// starts a compiler process per compile
+class OneShotCompilerBackend : public CompilerBackend
+{
+public:
+    OneShotCompilerBackend(const std::string &compilerExecutable);
+    void compile(const std::string &sheetPath, const std::string &midiFilePath, const OutputHandler &onOutput, const CancelCheck &isCancelled) override;
+private:
+    std::string compilerExecutable;
+};
+
+/**
+ * Keeps a worker process running and sends it one compile request after
+ * the other, so templates and lua modules stay loaded between compiles.
+ * Both directions use the same framing: the length of the payload in
+ * decimal digits and a line break, followed by the payload.
+ * A request is the json object `{"sheetPath": "...", "output": "..."}`, without
+ * `output` if the midi data is to stay in the json;
+ * a response is the json document `sheetc --mode=json` prints.
+ * The worker is (re)started on demand, a cancelled compile kills it.
+ */
+class WorkerCompilerBackend : public CompilerBackend
+{
+public:
+    WorkerCompilerBackend(const WorkerProcess::CommandLine &commandLine);
+    void compile(const std::string &sheetPath, const std::string &midiFilePath, const OutputHandler &onOutput, const CancelCheck &isCancelled) override;
+    static const size_t MaxResponseSize;
+    static const size_t READ_CHUNK_SIZE;
+    /// a compile waiting for the worker checks for cancellation that often
+    static const int WAIT_SLICE_TIME;
+private:
+    typedef std::timed_mutex Mutex;
+    Mutex mutex;
+    WorkerProcess::CommandLine commandLine;
+    std::unique_ptr<WorkerProcess> process;
+    std::vector<char> buffer;
+    bool readResponse(const OutputHandler &onOutput);
+};
+
+/// the worker set in the preferences, started as `<worker> <compilerExecutable>` and
+/// shared by all plugin instances in this process; a one-shot backend if there is none
+CompilerBackendPtr getCompilerBackend(const std::string &compilerExecutable);
@@ -0,0 +1,538 @@
+#include "CompilerOutputParser.h"
+#include "Base64.h"
+#include <juce_core/juce_core.h>
+#include <cstring>
+#include <stdexcept>
+
+namespace
+{
+    const char * UnexpectedResponse = "unexpected compiler response";
+
+    void fail()
+    {
+        throw std::runtime_error(UnexpectedResponse);
+    }
+
+    bool isNumberChar(char ch)
+    {
+        return (ch >= '0' && ch <= '9') || ch == '-' || ch == '+' || ch == '.' || ch == 'e' || ch == 'E';
+    }
+
+    bool isLiteralChar(char ch)
+    {
+        return ch >= 'a' && ch <= 'z';
+    }
+
+    double toDouble(const std::string &number)
+    {
+        // locale independent, unlike strtod
+        juce::CharPointer_UTF8 text(number.c_str());
+        return juce::CharacterFunctions::readDoubleValue(text);
+    }
+
+    bool isSheetEventInfoField(const std::string &key)
+    {
+        return key == "sourceId" || key == "beginPosition" || key == "endPosition"
+            || key == "beginTime" || key == "endTime";
+    }
+
+    int hexValue(char ch)
+    {
+        if (ch >= '0' && ch <= '9') return ch - '0';
+        if (ch >= 'a' && ch <= 'f') return ch - 'a' + 10;
+        if (ch >= 'A' && ch <= 'F') return ch - 'A' + 10;
+        fail();
+        return 0;
+    }
+}
+
+CompilerOutputParser::CompilerOutputParser(CompiledSheet &sheet_) : sheet(sheet_)
+{
+}
+
+void CompilerOutputParser::feed(const char *data, size_t numBytes)
+{
+    while (numBytes > 0)
+    {
+        size_t consumed = 1;
+        switch (state)
+        {
+        case State::Value:
+            consumed = readValue(data, numBytes);
+            break;
+        case State::String:
+            consumed = readString(data, numBytes);
+            break;
+        case State::Escape:
+            readEscape(*data);
+            break;
+        case State::UnicodeEscape:
+            readUnicodeEscape(*data);
+            break;
+        case State::Number:
+        case State::Literal:
+            if (state == State::Number ? isNumberChar(*data) : isLiteralChar(*data))
+            {
+                token += *data;
+                break;
+            }
+            // the character after the token is read again as part of the structure
+            onToken(state == State::Number ? TokenType::Number : TokenType::Literal);
+            state = State::Value;
+            consumed = 0;
+            break;
+        case State::Done:
+            // anything after the document is not ours
+            return;
+        }
+        data += consumed;
+        numBytes -= consumed;
+    }
+}
+
+void CompilerOutputParser::finish()
+{
+    if (state != State::Done)
+    {
+        fail();
+    }
+}
+
+size_t CompilerOutputParser::readValue(const char *data, size_t numBytes)
+{
+    size_t i = 0;
+    for (; i < numBytes; ++i)
+    {
+        auto ch = data[i];
+        switch (ch)
+        {
+        case ' ': case '\t': case '\r': case '\n':
+            continue;
+        case '{': case '[':
+            beginContainer(ch == '{');
+            break;
+        case '}': case ']':
+            if (expectsValue)
+            {
+                fail();
+            }
+            endContainer(ch == '}');
+            break;
+        case ':':
+            expectsValue = true;
+            break;
+        case ',':
+            if (frames.empty() || expectsValue)
+            {
+                fail();
+            }
+            frames.back().expectsKey = frames.back().isObject;
+            break;
+        case '"':
+            beginString();
+            return i + 1;
+        default:
+            if (frames.empty() || !(isNumberChar(ch) || isLiteralChar(ch)))
+            {
+                fail();
+            }
+            token.clear();
+            state = isLiteralChar(ch) && ch != 'e' ? State::Literal : State::Number;
+            return i;
+        }
+        if (state == State::Done)
+        {
+            return i + 1;
+        }
+    }
+    return i;
+}
+
+size_t CompilerOutputParser::readString(const char *data, size_t numBytes)
+{
+    size_t i = 0;
+    while (i < numBytes && data[i] != '"' && data[i] != '\\')
+    {
+        ++i;
+    }
+    if (isKeepingString)
+    {
+        token.append(data, i);
+    }
+    if (i == numBytes)
+    {
+        return i;
+    }
+    if (data[i] == '\\')
+    {
+        state = State::Escape;
+        return i + 1;
+    }
+    state = State::Value;
+    onToken(TokenType::String);
+    return i + 1;
+}
+
+void CompilerOutputParser::readEscape(char ch)
+{
+    state = State::String;
+    char unescaped = ch;
+    switch (ch)
+    {
+    case '"': case '\\': case '/': break;
+    case 'b': unescaped = '\b'; break;
+    case 'f': unescaped = '\f'; break;
+    case 'n': unescaped = '\n'; break;
+    case 'r': unescaped = '\r'; break;
+    case 't': unescaped = '\t'; break;
+    case 'u':
+        state = State::UnicodeEscape;
+        numUnicodeDigits = 0;
+        unicodeValue = 0;
+        return;
+    default:
+        fail();
+    }
+    if (isKeepingString)
+    {
+        token += unescaped;
+    }
+}
+
+void CompilerOutputParser::readUnicodeEscape(char ch)
+{
+    unicodeValue = (unicodeValue << 4) | (unsigned)hexValue(ch);
+    if (++numUnicodeDigits < 4)
+    {
+        return;
+    }
+    state = State::String;
+    if (unicodeValue >= 0xD800 && unicodeValue < 0xDC00)
+    {
+        highSurrogate = unicodeValue;
+        return;
+    }
+    if (unicodeValue >= 0xDC00 && unicodeValue < 0xE000 && highSurrogate != 0)
+    {
+        unicodeValue = 0x10000 + ((highSurrogate - 0xD800) << 10) + (unicodeValue - 0xDC00);
+    }
+    highSurrogate = 0;
+    if (isKeepingString)
+    {
+        appendCodePoint(unicodeValue);
+    }
+}
+
+void CompilerOutputParser::appendCodePoint(unsigned codePoint)
+{
+    if (codePoint < 0x80)
+    {
+        token += (char)codePoint;
+    }
+    else if (codePoint < 0x800)
+    {
+        token += (char)(0xC0 | (codePoint >> 6));
+        token += (char)(0x80 | (codePoint & 0x3F));
+    }
+    else if (codePoint < 0x10000)
+    {
+        token += (char)(0xE0 | (codePoint >> 12));
+        token += (char)(0x80 | ((codePoint >> 6) & 0x3F));
+        token += (char)(0x80 | (codePoint & 0x3F));
+    }
+    else
+    {
+        token += (char)(0xF0 | (codePoint >> 18));
+        token += (char)(0x80 | ((codePoint >> 12) & 0x3F));
+        token += (char)(0x80 | ((codePoint >> 6) & 0x3F));
+        token += (char)(0x80 | (codePoint & 0x3F));
+    }
+}
+
+CompilerOutputParser::Role CompilerOutputParser::getChildRole(const Frame &parent, bool isObject) const
+{
+    switch (parent.role)
+    {
+    case Role::Root:
+        if (parent.key == "midi" && isObject) return Role::Midi;
+        if (parent.key == "eventInfos" && !isObject) return Role::EventInfos;
+        break;
+    case Role::Midi:
+        if (parent.key == "sources" && !isObject) return Role::Sources;
+        break;
+    case Role::Sources:
+        if (isObject) return Role::Source;
+        break;
+    case Role::EventInfos:
+        if (isObject) return Role::EventInfo;
+        break;
+    case Role::EventInfo:
+        if (parent.key == "sheetEventInfos" && !isObject) return Role::SheetEventInfos;
+        break;
+    case Role::SheetEventInfos:
+        if (isObject) return Role::SheetEventInfo;
+        break;
+    case Role::Source:
+    case Role::SheetEventInfo:
+    case Role::Ignored:
+        break;
+    }
+    return Role::Ignored;
+}
+
+void CompilerOutputParser::beginContainer(bool isObject)
+{
+    expectsValue = false;
+    Role role = Role::Root;
+    if (frames.empty())
+    {
+        if (!isObject)
+        {
+            fail();
+        }
+    }
+    else
+    {
+        if (frames.back().isObject && frames.back().expectsKey)
+        {
+            fail();
+        }
+        role = getChildRole(frames.back(), isObject);
+    }
+    switch (role)
+    {
+    case Role::Midi: hasMidi = true; break;
+    case Role::Sources: hasSources = true; break;
+    case Role::EventInfos: hasEventInfos = true; break;
+    case Role::EventInfo: hasSheetEventInfos = false; break;
+    case Role::SheetEventInfos: hasSheetEventInfos = true; break;
+    case Role::Source: source = Source(); sourceFields = 0; break;
+    case Role::SheetEventInfo: eventInfo = DocumentEventInfo(); eventInfoFields = 0; break;
+    case Role::Root: case Role::Ignored: break;
+    }
+    frames.push_back({ role, isObject, isObject, std::string() });
+}
+
+void CompilerOutputParser::endContainer(bool isObject)
+{
+    if (frames.empty() || frames.back().isObject != isObject)
+    {
+        fail();
+    }
+    const auto &frame = frames.back();
+    switch (frame.role)
+    {
+    case Role::Source:
+        if (sourceFields != 3)
+        {
+            fail();
+        }
+        sheet.sources.push_back(source);
+        break;
+    case Role::EventInfo:
+        if (!hasSheetEventInfos)
+        {
+            // every event info has its sheet event infos
+            fail();
+        }
+        break;
+    case Role::SheetEventInfo:
+    {
+        if ((eventInfoFields & AllRequired) != AllRequired)
+        {
+            fail();
+        }
+        EventPositionSet value = { eventInfo };
+        sheet.eventInfos += std::make_pair(TimelineIntervalType::right_open(eventInfo.beginTime, eventInfo.endTime), value);
+        break;
+    }
+    case Role::Root:
+    case Role::Midi:
+    case Role::Sources:
+    case Role::EventInfos:
+    case Role::SheetEventInfos:
+    case Role::Ignored:
+        break;
+    }
+    frames.pop_back();
+    if (frames.empty())
+    {
+        state = State::Done;
+    }
+}
+
+bool CompilerOutputParser::wantsString(const Frame &frame) const
+{
+    switch (frame.role)
+    {
+    case Role::Root:
+        return frame.key == "errorMessage" || frame.key == "sourceFile" || frame.key == "positionBegin";
+    case Role::Midi:
+        return frame.key == "midiData";
+    case Role::Source:
+        return frame.key == "sourceId" || frame.key == "path";
+    case Role::SheetEventInfo:
+        return isSheetEventInfoField(frame.key);
+    case Role::Sources:
+    case Role::EventInfos:
+    case Role::EventInfo:
+    case Role::SheetEventInfos:
+    case Role::Ignored:
+        break;
+    }
+    return false;
+}
+
+void CompilerOutputParser::beginString()
+{
+    if (frames.empty())
+    {
+        fail();
+    }
+    const auto &frame = frames.back();
+    // keys are always kept, values only if they are of use
+    isKeepingString = (frame.isObject && frame.expectsKey) || wantsString(frame);
+    token.clear();
+    highSurrogate = 0;
+    state = State::String;
+}
+
+void CompilerOutputParser::onToken(TokenType type)
+{
+    auto &frame = frames.back();
+    if (frame.isObject && frame.expectsKey)
+    {
+        if (type != TokenType::String)
+        {
+            fail();
+        }
+        frame.key = token;
+        frame.expectsKey = false;
+        return;
+    }
+    expectsValue = false;
+    if (type == TokenType::Literal && token != "true" && token != "false" && token != "null")
+    {
+        fail();
+    }
+    if (type == TokenType::Literal && token == "null")
+    {
+        // a null value counts as absent
+        return;
+    }
+    onValue(frame, type);
+}
+
+void CompilerOutputParser::onValue(Frame &frame, TokenType type)
+{
+    const auto &key = frame.key;
+    switch (frame.role)
+    {
+    case Role::Root:
+        if (key == "errorMessage")
+        {
+            errorMessage = token;
+            hasErrorMessage = true;
+        }
+        else if (key == "sourceFile")
+        {
+            sourceFile = token;
+            hasSourceFile = true;
+        }
+        else if (key == "positionBegin")
+        {
+            position = token;
+            hasPosition = true;
+        }
+        break;
+    case Role::Midi:
+        if (key == "midiData" && type == TokenType::String && !token.empty())
+        {
+            if (!decodeBase64(token.data(), token.size(), sheet.midiData))
+            {
+                throw std::runtime_error("invalid midi data");
+            }
+            std::string().swap(token);
+        }
+        break;
+    case Role::Source:
+        if (key == "sourceId")
+        {
+            source.sourceId = token;
+            sourceFields |= 1;
+        }
+        else if (key == "path")
+        {
+            source.path = token;
+            sourceFields |= 2;
+        }
+        break;
+    case Role::SheetEventInfo:
+    {
+        // the former json code read these through juce::var, which converts strings and booleans too
+        juce::int64 integer = 0;
+        double real = 0;
+        if (type == TokenType::String)
+        {
+            juce::String text(token);
+            integer = text.getLargeIntValue();
+            real = text.getDoubleValue();
+        }
+        else if (type == TokenType::Literal)
+        {
+            integer = token == "true" ? 1 : 0;
+            real = (double)integer;
+        }
+        else
+        {
+            real = toDouble(token);
+            integer = (juce::int64)real;
+        }
+        if (key == "sourceId")
+        {
+            eventInfo.sourceId = (unsigned)integer;
+            eventInfoFields |= SourceId;
+        }
+        else if (key == "beginPosition")
+        {
+            eventInfo.beginPosition = (int)integer;
+            eventInfoFields |= BeginPosition;
+        }
+        else if (key == "endPosition")
+        {
+            eventInfo.endPosition = (int)integer;
+        }
+        else if (key == "beginTime")
+        {
+            eventInfo.beginTime = real;
+            eventInfoFields |= BeginTime;
+        }
+        else if (key == "endTime")
+        {
+            eventInfo.endTime = real;
+            eventInfoFields |= EndTime;
+        }
+        break;
+    }
+    case Role::Sources:
+    case Role::EventInfos:
+    case Role::EventInfo:
+    case Role::SheetEventInfos:
+    case Role::Ignored:
+        break;
+    }
+}
+
+std::string CompilerOutputParser::getErrorMessage() const
+{
+    std::string result;
+    if (hasSourceFile)
+    {
+        result += "in file \"" + sourceFile + "\"";
+    }
+    if (hasPosition)
+    {
+        result += ": position " + position;
+    }
+    return result + "\n" + errorMessage;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "CompiledSheet.h"
+
+/**
+ * Reads the json document of a compile while it arrives and fills a
+ * CompiledSheet on the way, without building a json tree first.
+ * Only the values the plugin uses are kept, everything else is skipped
+ * as it is read. Chunks may end anywhere, also within a token.
+ */
+class CompilerOutputParser
+{
+public:
+    CompilerOutputParser(CompiledSheet &sheet);
+    /// throws std::runtime_error on malformed input
+    void feed(const char *data, size_t numBytes);
+    /// after the last chunk, throws std::runtime_error if the document is incomplete
+    void finish();
+    /// the compiler reported an error, see getErrorMessage()
+    bool hasError() const { return hasErrorMessage; }
+    /// the error message with the file and position if the compiler named them
+    std::string getErrorMessage() const;
+    /// the document had all parts a successful compile delivers
+    bool isComplete() const { return hasMidi && hasSources && hasEventInfos; }
+private:
+    enum class State { Value, String, Escape, UnicodeEscape, Number, Literal, Done };
+    enum class Role { Root, Midi, Sources, Source, EventInfos, EventInfo, SheetEventInfos, SheetEventInfo, Ignored };
+    enum class TokenType { String, Number, Literal };
+    struct Frame
+    {
+        Role role;
+        bool isObject;
+        bool expectsKey;
+        std::string key;
+    };
+    typedef std::vector<Frame> Frames;
+    /// required fields of a sheet event info
+    enum EventInfoField { SourceId = 1, BeginPosition = 2, BeginTime = 4, EndTime = 8, AllRequired = 15 };
+    CompiledSheet &sheet;
+    State state = State::Value;
+    Frames frames;
+    std::string token;
+    bool isKeepingString = false;
+    /// a colon was read, the value is still missing
+    bool expectsValue = false;
+    int numUnicodeDigits = 0;
+    unsigned unicodeValue = 0;
+    unsigned highSurrogate = 0;
+    bool hasMidi = false;
+    bool hasSources = false;
+    bool hasEventInfos = false;
+    bool hasSheetEventInfos = false;
+    bool hasErrorMessage = false;
+    bool hasSourceFile = false;
+    bool hasPosition = false;
+    std::string errorMessage;
+    std::string sourceFile;
+    std::string position;
+    Source source;
+    int sourceFields = 0;
+    DocumentEventInfo eventInfo;
+    int eventInfoFields = 0;
+    /// returns the number of bytes consumed, which ends a token
+    size_t readValue(const char *data, size_t numBytes);
+    size_t readString(const char *data, size_t numBytes);
+    void readEscape(char ch);
+    void readUnicodeEscape(char ch);
+    void appendCodePoint(unsigned codePoint);
+    void beginContainer(bool isObject);
+    void endContainer(bool isObject);
+    void beginString();
+    void onToken(TokenType type);
+    void onValue(Frame &frame, TokenType type);
+    Role getChildRole(const Frame &parent, bool isObject) const;
+    bool wantsString(const Frame &frame) const;
+};
@@ -0,0 +1,141 @@
+#include "CompilerRegistry.h"
+#include "PreferencesData.h"
+#include "Subprocess.hpp"
+#include <cctype>
+
+#define LOCK(mutex) std::lock_guard<Mutex> guard(mutex)
+
+namespace
+{
+    const char * CompilerName = "sheetc";
+#if JUCE_WINDOWS
+    const char * ExecutableSuffix = ".exe";
+    const char * PathSeparator = ";";
+#else
+    const char * ExecutableSuffix = "";
+    const char * PathSeparator = ":";
+    /// hosts started from the desktop often miss it in their PATH
+    const char * DefaultCompilerPath = "/usr/local/bin/sheetc";
+#endif
+
+    juce::File getExecutableIn(const juce::String &directory)
+    {
+        return juce::File(juce::File::addTrailingSeparator(directory) + CompilerName + ExecutableSuffix);
+    }
+
+    juce::int64 getModificationTime(const std::string &executable)
+    {
+        juce::File file(executable);
+        return file.existsAsFile() ? file.getLastModificationTime().toMilliseconds() : 0;
+    }
+}
+
+CompilerRegistry& CompilerRegistry::getInstance()
+{
+    static CompilerRegistry instance;
+    return instance;
+}
+
+std::string CompilerRegistry::findExecutable(const std::string &binPath)
+{
+    if (!binPath.empty())
+    {
+        return getExecutableIn(binPath).getFullPathName().toStdString();
+    }
+    juce::StringArray directories;
+    directories.addTokens(juce::SystemStats::getEnvironmentVariable("PATH", ""), PathSeparator, "\"");
+    for (const auto &directory : directories)
+    {
+        if (directory.isEmpty())
+        {
+            continue;
+        }
+        auto executable = getExecutableIn(directory);
+        if (executable.existsAsFile())
+        {
+            return executable.getFullPathName().toStdString();
+        }
+    }
+#if JUCE_WINDOWS
+    return CompilerName;
+#else
+    return DefaultCompilerPath;
+#endif
+}
+
+CompilerRegistry::CompilerInfo CompilerRegistry::getCompiler()
+{
+    auto currentBinPath = readPreferencesData().binPath;
+    auto executable = findExecutable(currentBinPath);
+    auto currentModificationTime = getModificationTime(executable);
+    LOCK(mutex);
+    bool isUpToDate = hasCompiler 
+        && currentBinPath == binPath 
+        && executable == compiler.executable 
+        && currentModificationTime == modificationTime;
+    if (isUpToDate)
+    {
+        return compiler;
+    }
+    binPath = currentBinPath;
+    modificationTime = currentModificationTime;
+    compiler.executable = executable;
+    compiler.version = Subprocess(executable, {"--version"}).readAllOutput();
+    compiler.versionNumber = parseVersionNumber(compiler.version);
+    // no release note says since when --output works in json mode, so the compiler is asked
+    compiler.writesMidiFile = !compiler.version.empty() && supportsOutputOption(executable);
+    hasCompiler = true;
+    return compiler;
+}
+
+bool CompilerRegistry::supportsOutputOption(const std::string &executable)
+{
+    Subprocess process(executable, {"--help"});
+    auto helpText = process.readAllOutput();
+    // some option parsers print the help to stderr
+    return mentionsOutputOption(helpText) || mentionsOutputOption(process.getErrorOutput());
+}
+
+bool CompilerRegistry::mentionsOutputOption(const std::string &helpText)
+{
+    const std::string option = "--output";
+    for (auto pos = helpText.find(option); pos != std::string::npos; pos = helpText.find(option, pos + 1))
+    {
+        auto end = pos + option.size();
+        if (end == helpText.size())
+        {
+            return true;
+        }
+        auto next = helpText[end];
+        if (!std::isalnum((unsigned char)next) && next != '-' && next != '_')
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// https://onlinegdb.com/aPPpWOYyd
+int CompilerRegistry::parseVersionNumber(const std::string &versionStr)
+{
+    if (versionStr.empty())
+    {
+        return 0;
+    }
+    int base = 10000;
+    int version = 0;
+    for (char ch : versionStr) 
+    {
+        if (ch == '.') 
+        {
+            continue;
+        }
+        if (ch < '0' || ch > '9') 
+        {
+            break;
+        }
+        version += (ch - '0') * base;
+        base /= 10;
+    }
+    return version;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <mutex>
+#include <string>
+
+/**
+ * Finds the werckmeister compiler and asks for its version once per process,
+ * all plugin instances share the result.
+ * The compiler is probed again only if the bin path in the preferences or
+ * the modification time of the executable changed. Finding the executable
+ * itself needs no process, the PATH is searched in place.
+ */
+class CompilerRegistry
+{
+public:
+    struct CompilerInfo
+    {
+        std::string executable;
+        /// empty if the compiler could not be run
+        std::string version;
+        /// see parseVersionNumber()
+        int versionNumber = 0;
+        /// the compiler writes the midi data to the file passed with `--output`
+        /// in json mode, instead of embedding it into the json; see supportsOutputOption()
+        bool writesMidiFile = false;
+        /// the executable and its version, e.g. to key caches
+        std::string id() const { return executable + " -- " + version; }
+    };
+    static CompilerRegistry& getInstance();
+    /// "1.0.42" becomes 10420, 0 if `versionStr` is empty
+    static int parseVersionNumber(const std::string &versionStr);
+    /// asks `executable --help` for the `--output` option, false if the compiler doesn't run
+    static bool supportsOutputOption(const std::string &executable);
+    /// `helpText` lists `--output`, an option which merely begins with it doesn't count
+    static bool mentionsOutputOption(const std::string &helpText);
+    /// any thread, runs the compiler only if something changed since the last call
+    CompilerInfo getCompiler();
+private:
+    typedef std::mutex Mutex;
+    Mutex mutex;
+    bool hasCompiler = false;
+    std::string binPath;
+    juce::int64 modificationTime = 0;
+    CompilerInfo compiler;
+    CompilerRegistry() = default;
+    static std::string findExecutable(const std::string &binPath);
+};
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <string>
+
+/**
+ * FNV-1a over bytes, strings and file contents.
+ * Fast and stable across runs and platforms, not meant to resist attacks.
+ */
+class ContentHash
+{
+public:
+    typedef juce::uint64 Value;
+    void add(const void *data, size_t numBytes)
+    {
+        auto bytes = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < numBytes; ++i)
+        {
+            value = (value ^ bytes[i]) * 1099511628211ull;
+        }
+    }
+    /// the terminator is hashed as well, it separates adjacent strings
+    void add(const std::string &str) { add(str.c_str(), str.size() + 1); }
+    /// false if the file can not be read
+    bool addFile(const juce::File &file)
+    {
+        juce::MemoryBlock content;
+        if (!file.existsAsFile() || !file.loadFileAsData(content))
+        {
+            return false;
+        }
+        add(content.getData(), content.getSize());
+        return true;
+    }
+    Value getValue() const { return value; }
+private:
+    Value value = 14695981039346656037ull;
+};
@@ -6,6 +6,7 @@
 
 
 const int FileWatcher::THREAD_IDLE_TIME = 50;
+const int FileWatcher::DEBOUNCE_TIME = 200;
 FileWatcher::FileWatcher() : Thread("File Watcher Thread")
 {
 	
@@ -24,11 +25,13 @@ void FileWatcher::run()
 void FileWatcher::setFileList(const FileList& fileList)
 {
 	LOCK(mutex);
-	lastUpdatedMap.clear();
+	watchedFiles.clear();
 	for (const auto& file : fileList)
 	{
-		auto timeStamp = getTimeStamp(file);
-		lastUpdatedMap.insert({file, timeStamp});
+		WatchedFile watchedFile;
+		watchedFile.timeStamp = getTimeStamp(file);
+		watchedFile.contentHash = getContentHash(file);
+		watchedFiles.insert({file, watchedFile});
 	}
 }
 
@@ -41,15 +44,40 @@ void FileWatcher::checkFiles()
 {
 	LOCK(mutex);
 	lastChangedFile = "";
-	for (auto& fileTimeStampPair : lastUpdatedMap)
+	bool hasPendingFiles = false;
+	auto now = juce::Time::getMillisecondCounter();
+	for (auto& pathFilePair : watchedFiles)
 	{
-		auto timeStamp = getTimeStamp(fileTimeStampPair.first);
-		if (timeStamp == fileTimeStampPair.second)
+		auto& watchedFile = pathFilePair.second;
+		auto timeStamp = getTimeStamp(pathFilePair.first);
+		if (timeStamp != watchedFile.timeStamp)
+		{
+			watchedFile.timeStamp = timeStamp;
+			watchedFile.isPending = true;
+			lastWriteTime = now;
+		}
+		hasPendingFiles = hasPendingFiles || watchedFile.isPending;
+	}
+	if (!hasPendingFiles || now - lastWriteTime < (juce::uint32)DEBOUNCE_TIME)
+	{
+		return;
+	}
+	// the writes settled, the content is read once per burst
+	for (auto& pathFilePair : watchedFiles)
+	{
+		auto& watchedFile = pathFilePair.second;
+		if (!watchedFile.isPending)
+		{
+			continue;
+		}
+		watchedFile.isPending = false;
+		auto contentHash = getContentHash(pathFilePair.first);
+		if (contentHash == watchedFile.contentHash)
 		{
 			continue;
 		}
-		fileTimeStampPair.second = timeStamp;
-		lastChangedFile = fileTimeStampPair.first;
+		watchedFile.contentHash = contentHash;
+		lastChangedFile = pathFilePair.first;
 	}
 	if (!lastChangedFile.empty())
 	{
@@ -62,7 +90,18 @@ FileWatcher::TimeStamp FileWatcher::getTimeStamp(const std::string& filePath) co
 	juce::File file(filePath);
 	if (!file.exists())
 	{
-		throw std::runtime_error("file not found:" + filePath);
+		return 0;
 	}
 	return file.getLastModificationTime().toMilliseconds();
+}
+
+ContentHash::Value FileWatcher::getContentHash(const std::string& filePath)
+{
+	ContentHash contentHash;
+	if (!contentHash.addFile(juce::File(filePath)))
+	{
+		// a missing file differs from any content, its reappearance is reported
+		return 0;
+	}
+	return contentHash.getValue();
 }
\ No newline at end of file
@@ -6,7 +6,14 @@
 #include <mutex>
 #include <functional>
 #include <juce_gui_basics/juce_gui_basics.h>
+#include "ContentHash.h"
 
+/**
+ * Calls `onFileChanged` on the message thread once the content of a
+ * watched file changed. A burst of writes is reported once, after the
+ * files did not change for DEBOUNCE_TIME. Saves which leave the content
+ * as it was, and touched files, are not reported.
+ */
 class FileWatcher : public juce::Thread, juce::AsyncUpdater
 {
 public:
@@ -18,14 +25,26 @@ public:
 	void run() override;
 	void handleAsyncUpdate() override;
 	static const int THREAD_IDLE_TIME;
+	static const int DEBOUNCE_TIME;
 private:
 	typedef std::mutex Mutex;
 	typedef juce::int64 TimeStamp;
-	typedef std::unordered_map<std::string, TimeStamp> LastUpdatedMap;
+	struct WatchedFile
+	{
+		TimeStamp timeStamp = 0;
+		/// the content the last notification was about
+		ContentHash::Value contentHash = 0;
+		/// the time stamp changed, the content is compared once the writes settled
+		bool isPending = false;
+	};
+	typedef std::unordered_map<std::string, WatchedFile> WatchedFiles;
 	std::string lastChangedFile;
-	LastUpdatedMap lastUpdatedMap;
+	WatchedFiles watchedFiles;
+	juce::uint32 lastWriteTime = 0;
 	Mutex mutex;
 	void checkFiles();
+	/// 0 if the file does not exist, e.g. while an editor replaces it
 	TimeStamp getTimeStamp(const std::string& filePath) const;
+	static ContentHash::Value getContentHash(const std::string& filePath);
 	
 };
@@ -38,6 +38,25 @@ namespace
 	}
 }
 
+void FilterToggleButton::mouseDown(const juce::MouseEvent& event)
+{
+	if (event.mods.isPopupMenu())
+	{
+		return;
+	}
+	juce::ToggleButton::mouseDown(event);
+}
+
+void FilterToggleButton::mouseUp(const juce::MouseEvent& event)
+{
+	if (event.mods.isPopupMenu())
+	{
+		onPopupMenu();
+		return;
+	}
+	juce::ToggleButton::mouseUp(event);
+}
+
 FilterComponent::FilterComponent()
 {
 	flexBox.flexDirection = juce::FlexBox::Direction::column;
@@ -80,6 +99,10 @@ void FilterComponent::setItems(const Items& newItems)
 			}
 			onFilterChanged(itemIndex, btn->getToggleState());
 		};
+		btn->onPopupMenu = [this, itemIndex]()
+		{
+			onItemMenu(itemIndex);
+		};
 		btn->setToggleState(true, false);
 		btn->setBounds(0, 0, 0, 20);
 		btn->changeWidthToFitText();
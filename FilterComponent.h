@@ -7,13 +7,25 @@
 #include <vector>
 #include <functional>
 
+//==============================================================================
+/// a toggle button which opens a popup menu on right click instead of toggling
+class FilterToggleButton : public juce::ToggleButton
+{
+public:
+    using juce::ToggleButton::ToggleButton;
+    std::function<void()> onPopupMenu = [](){};
+    void mouseDown(const juce::MouseEvent& event) override;
+    void mouseUp(const juce::MouseEvent& event) override;
+};
+
 //==============================================================================
 class FilterComponent : public juce::Component, public juce::AsyncUpdater
 {
 public:
     typedef std::function<void(int, bool)> FilterChangedHandler;
+    typedef std::function<void(int)> ItemMenuHandler;
     typedef std::vector<std::string> Items;
-    typedef juce::ToggleButton FilterControl;
+    typedef FilterToggleButton FilterControl;
     typedef std::shared_ptr<FilterControl> FilterControlPtr;
     FilterComponent();
     virtual ~FilterComponent() = default;
@@ -24,6 +36,7 @@ public:
     void clear();
     const Items& getItems() const { return items; }
     FilterChangedHandler onFilterChanged = [](int, bool){};
+    ItemMenuHandler onItemMenu = [](int){};
     void handleAsyncUpdate() override;
 private:
     juce::FlexBox flexBox;
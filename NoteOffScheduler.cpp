@@ -0,0 +1,21 @@
+#include "NoteOffScheduler.h"
+
+void NoteOffScheduler::reserve(size_t capacity)
+{
+	items.reserve(std::max<size_t>(capacity, 1));
+}
+
+void NoteOffScheduler::schedule(TickPosition tickPosition, PackedMessage noteOff, juce::uint32 trackIndex)
+{
+	jassert(!isFull());
+	items.push_back({ tickPosition, noteOff, trackIndex });
+	std::push_heap(items.begin(), items.end(), isLater);
+}
+
+NoteOffScheduler::Item NoteOffScheduler::pop()
+{
+	std::pop_heap(items.begin(), items.end(), isLater);
+	auto item = items.back();
+	items.pop_back();
+	return item;
+}
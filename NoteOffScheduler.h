@@ -0,0 +1,56 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <algorithm>
+#include <vector>
+
+/**
+ * Pending note offs ordered by their position in midi ticks.
+ * A min heap on storage reserved up front, so scheduling and popping
+ * never allocate as long as the capacity is not exceeded.
+ */
+class NoteOffScheduler
+{
+public:
+	typedef juce::int64 TickPosition;
+	typedef juce::uint32 PackedMessage;
+	struct Item
+	{
+		TickPosition tickPosition;
+		PackedMessage noteOff;
+		juce::uint32 trackIndex;
+	};
+	/// non realtime
+	void reserve(size_t capacity);
+	bool isEmpty() const { return items.empty(); }
+	bool isFull() const { return items.size() >= items.capacity(); }
+	size_t size() const { return items.size(); }
+	/// the caller has to make room via pop() if the scheduler isFull()
+	void schedule(TickPosition tickPosition, PackedMessage noteOff, juce::uint32 trackIndex);
+	/// the position of the earliest note off, the scheduler must not be empty
+	TickPosition nextPosition() const { return items.front().tickPosition; }
+	/// removes and returns the earliest note off, the scheduler must not be empty
+	Item pop();
+	void clear() { items.clear(); }
+	/// removes the note offs for which `predicate(const Item&)` holds
+	/// and calls `visit(const Item&)` for each of them, O(size)
+	template<typename Predicate, typename Visit>
+	void removeIf(Predicate &&predicate, Visit &&visit);
+private:
+	typedef std::vector<Item> Items;
+	Items items;
+	static bool isLater(const Item &a, const Item &b) { return a.tickPosition > b.tickPosition; }
+};
+
+template<typename Predicate, typename Visit>
+void NoteOffScheduler::removeIf(Predicate &&predicate, Visit &&visit)
+{
+	auto removed = std::partition(items.begin(), items.end(), [&predicate](const Item &item) { return !predicate(item); });
+	if (removed == items.end())
+	{
+		return;
+	}
+	std::for_each(removed, items.end(), visit);
+	items.erase(removed, items.end());
+	std::make_heap(items.begin(), items.end(), isLater);
+}
@@ -0,0 +1,58 @@
+#include "NoteSpanIndex.h"
+#include <algorithm>
+
+void NoteSpanIndex::build(NoteSpans spans)
+{
+	nodes.clear();
+	byBegin.clear();
+	byEnd.clear();
+	spans.erase(std::remove_if(spans.begin(), spans.end(), [](const NoteSpan &span) { return span.begin >= span.end; }), spans.end());
+	byBegin.reserve(spans.size());
+	byEnd.reserve(spans.size());
+	root = buildNode(spans);
+}
+
+juce::uint32 NoteSpanIndex::buildNode(NoteSpans &spans)
+{
+	if (spans.empty())
+	{
+		return NoNode;
+	}
+	// the median begin lies within its own span, so every node takes at least one
+	auto median = spans.begin() + (NoteSpans::difference_type)(spans.size() / 2);
+	std::nth_element(spans.begin(), median, spans.end(), [](const NoteSpan &a, const NoteSpan &b) { return a.begin < b.begin; });
+	auto center = median->begin;
+	NoteSpans left, right, containing;
+	for (const auto &span : spans)
+	{
+		if (span.end <= center)
+		{
+			left.push_back(span);
+		}
+		else if (span.begin > center)
+		{
+			right.push_back(span);
+		}
+		else
+		{
+			containing.push_back(span);
+		}
+	}
+	spans.clear();
+	spans.shrink_to_fit();
+	Node node;
+	node.center = center;
+	node.first = (juce::uint32)byBegin.size();
+	node.last = node.first + (juce::uint32)containing.size();
+	std::sort(containing.begin(), containing.end(), [](const NoteSpan &a, const NoteSpan &b) { return a.begin < b.begin; });
+	byBegin.insert(byBegin.end(), containing.begin(), containing.end());
+	std::sort(containing.begin(), containing.end(), [](const NoteSpan &a, const NoteSpan &b) { return a.end > b.end; });
+	byEnd.insert(byEnd.end(), containing.begin(), containing.end());
+	auto nodeIndex = (juce::uint32)nodes.size();
+	nodes.push_back(node);
+	auto leftIndex = buildNode(left);
+	auto rightIndex = buildNode(right);
+	nodes[nodeIndex].left = leftIndex;
+	nodes[nodeIndex].right = rightIndex;
+	return nodeIndex;
+}
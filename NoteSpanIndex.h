@@ -0,0 +1,78 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <vector>
+#include "NoteOffScheduler.h"
+
+/**
+ * The spans of all notes of a sheet from note on to note off, as a
+ * centered interval tree in flat arrays.
+ * Answers which notes are sounding at a position in O(log n + k),
+ * the query walks a single path from the root and does not allocate.
+ */
+class NoteSpanIndex
+{
+public:
+	typedef NoteOffScheduler::TickPosition TickPosition;
+	struct NoteSpan
+	{
+		TickPosition begin;
+		TickPosition end;
+		juce::uint32 trackIndex;
+		juce::uint32 eventIndex;
+	};
+	typedef std::vector<NoteSpan> NoteSpans;
+	/// non realtime: spans with begin >= end are dropped
+	void build(NoteSpans spans);
+	/// calls `visit(const NoteSpan&)` for every span with begin < position < end
+	template<typename Visit>
+	void forEachSoundingAt(TickPosition position, Visit &&visit) const;
+private:
+	static const juce::uint32 NoNode = 0xFFFFFFFF;
+	/// spans[first, last) in byBegin and byEnd are the spans containing center
+	struct Node
+	{
+		TickPosition center;
+		juce::uint32 first;
+		juce::uint32 last;
+		juce::uint32 left;
+		juce::uint32 right;
+	};
+	typedef std::vector<Node> Nodes;
+	juce::uint32 buildNode(NoteSpans &spans);
+	Nodes nodes;
+	/// per node sorted by begin, ascending
+	NoteSpans byBegin;
+	/// per node sorted by end, descending
+	NoteSpans byEnd;
+	juce::uint32 root = NoNode;
+};
+
+template<typename Visit>
+void NoteSpanIndex::forEachSoundingAt(TickPosition position, Visit &&visit) const
+{
+	auto nodeIndex = root;
+	while (nodeIndex != NoNode)
+	{
+		const auto &node = nodes[nodeIndex];
+		if (position < node.center)
+		{
+			// every span of the node ends after center, so only the begin matters
+			for (auto i = node.first; i < node.last && byBegin[i].begin < position; ++i)
+			{
+				visit(byBegin[i]);
+			}
+			nodeIndex = node.left;
+			continue;
+		}
+		// every span of the node begins at or before center, so only the end matters
+		for (auto i = node.first; i < node.last && byEnd[i].end > position; ++i)
+		{
+			if (byEnd[i].begin < position)
+			{
+				visit(byEnd[i]);
+			}
+		}
+		nodeIndex = node.right;
+	}
+}
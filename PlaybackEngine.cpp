@@ -0,0 +1,283 @@
+#include "PlaybackEngine.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	/// heap order: the earliest event on top, ties are broken by the track index
+	bool isLater(const MergeHeapItem &a, const MergeHeapItem &b)
+	{
+		if (a.tickPosition != b.tickPosition)
+		{
+			return a.tickPosition > b.tickPosition;
+		}
+		return a.trackIndex > b.trackIndex;
+	}
+
+	/// the host position may drift by rounding, anything closer is not a jump
+	const double MaxPositionDriftInTicks = 1.0;
+
+	double getBlockLengthInTicks(const PlaybackEngine::Block& block, int ticksPerQuarterNote)
+	{
+		return block.numSamples * block.bpm * ticksPerQuarterNote / (60.0 * block.sampleRate);
+	}
+}
+
+void PlaybackEngine::setSnapshot(PlaybackSnapshot* snapshot_)
+{
+	snapshot = snapshot_;
+	hasNextBlock = false;
+	seenMuteGeneration = 0;
+	hasLoopStartCursors = false;
+	if (snapshot != nullptr)
+	{
+		clock.setTicksPerQuarterNote(snapshot->ticksPerQuarterNote);
+	}
+}
+
+void PlaybackEngine::sendAllNoteOff(juce::MidiBuffer& midiMessages)
+{
+	// the active notes survive a snapshot swap, they are the state of the output
+	activeNotes.releaseAll(midiMessages, 0);
+	if (snapshot != nullptr)
+	{
+		snapshot->noteOffScheduler.clear();
+	}
+	// the next block starts over with a seek, even at the same position, to chase the released notes
+	hasNextBlock = false;
+}
+
+void PlaybackEngine::flushNoteOffs(int sampleOffset, juce::MidiBuffer& midiMessages)
+{
+	auto &scheduler = snapshot->noteOffScheduler;
+	while (!scheduler.isEmpty())
+	{
+		sendNoteOff(scheduler.pop().noteOff, sampleOffset, midiMessages);
+	}
+}
+
+void PlaybackEngine::sendNoteOff(TrackEvents::PackedMessage noteOff, int sampleOffset, juce::MidiBuffer& midiMessages)
+{
+	++stats.eventsEmitted;
+	activeNotes.update(noteOff);
+	addPackedMessage(midiMessages, noteOff, sampleOffset);
+}
+
+void PlaybackEngine::sendTrackEvent(size_t trackIndex, size_t eventIndex, int sampleOffset, juce::MidiBuffer& midiMessages)
+{
+	const auto &track = snapshot->tracks[trackIndex];
+	++stats.eventsEmitted;
+	activeNotes.update(track.messages[eventIndex]);
+	track.addEventTo(midiMessages, eventIndex, sampleOffset);
+}
+
+void PlaybackEngine::releaseMutedTracks(juce::MidiBuffer& midiMessages)
+{
+	auto muteGeneration = snapshot->muteGeneration.load(std::memory_order_acquire);
+	if (muteGeneration == seenMuteGeneration)
+	{
+		return;
+	}
+	seenMuteGeneration = muteGeneration;
+	snapshot->noteOffScheduler.removeIf(
+		[this](const NoteOffScheduler::Item &item) { return snapshot->isMuted(item.trackIndex); },
+		[this, &midiMessages](const NoteOffScheduler::Item &item) { sendNoteOff(item.noteOff, 0, midiMessages); });
+}
+
+int PlaybackEngine::toSampleOffset(TickPosition position, SamplePosition blockBegin) const
+{
+	return (int)std::max<SamplePosition>(0, clock.sampleAt(position) - blockBegin);
+}
+
+void PlaybackEngine::emitNoteOffs(TickPosition until, SamplePosition blockBegin, juce::MidiBuffer& midiMessages)
+{
+	auto &scheduler = snapshot->noteOffScheduler;
+	while (!scheduler.isEmpty() && scheduler.nextPosition() < until)
+	{
+		auto item = scheduler.pop();
+		sendNoteOff(item.noteOff, toSampleOffset(item.tickPosition, blockBegin), midiMessages);
+	}
+}
+
+bool PlaybackEngine::isContinuous(double hostTick) const
+{
+	return hasNextBlock && std::abs(hostTick - nextBlockBeginTick) <= nextBlockMaxDrift;
+}
+
+void PlaybackEngine::seek(TickPosition position)
+{
+	snapshot->mergeHeap.clear();
+	for (size_t trackIndex = 0; trackIndex < snapshot->numTracks(); ++trackIndex)
+	{
+		snapshot->trackCursors[trackIndex] = snapshot->tracks[trackIndex].seek(position);
+		pushTrack(trackIndex);
+	}
+	stats.tracksVisited += (int)snapshot->numTracks();
+}
+
+void PlaybackEngine::seekLoopStart(TickPosition loopStart)
+{
+	if (hasLoopStartCursors && loopStartCursorsPosition == loopStart)
+	{
+		// plain copies into reserved storage, no search
+		snapshot->trackCursors = snapshot->loopStartCursors;
+		snapshot->mergeHeap = snapshot->loopStartHeap;
+		return;
+	}
+	seek(loopStart);
+	snapshot->loopStartCursors = snapshot->trackCursors;
+	snapshot->loopStartHeap = snapshot->mergeHeap;
+	loopStartCursorsPosition = loopStart;
+	hasLoopStartCursors = true;
+}
+
+void PlaybackEngine::pushTrack(size_t trackIndex)
+{
+	const auto &track = snapshot->tracks[trackIndex];
+	auto eventIndex = snapshot->trackCursors[trackIndex];
+	if (eventIndex >= track.size())
+	{
+		return;
+	}
+	auto &heap = snapshot->mergeHeap;
+	heap.push_back({ track.tickPositions[eventIndex], trackIndex });
+	std::push_heap(heap.begin(), heap.end(), isLater);
+}
+
+void PlaybackEngine::chaseChannelStates(int sampleOffset, juce::MidiBuffer& midiMessages)
+{
+	auto &channelStates = snapshot->chaseStates;
+	for (size_t trackIndex = 0; trackIndex < snapshot->numTracks(); ++trackIndex)
+	{
+		const auto &track = snapshot->tracks[trackIndex];
+		if (track.chaseStates.empty() || snapshot->isMuted(trackIndex))
+		{
+			continue;
+		}
+		track.getChannelStatesAt(snapshot->trackCursors[trackIndex], channelStates);
+		channelStates.addTo(midiMessages, sampleOffset);
+	}
+}
+
+void PlaybackEngine::chaseSoundingNotes(TickPosition position, int sampleOffset, juce::MidiBuffer& midiMessages)
+{
+	auto &scheduler = snapshot->noteOffScheduler;
+	snapshot->noteSpans.forEachSoundingAt(position, [&](const NoteSpanIndex::NoteSpan &span)
+	{
+		if (snapshot->isMuted(span.trackIndex) || scheduler.isFull())
+		{
+			return;
+		}
+		const auto &track = snapshot->tracks[span.trackIndex];
+		auto noteOffIndex = (size_t)track.noteOffIndices[span.eventIndex];
+		sendTrackEvent(span.trackIndex, span.eventIndex, sampleOffset, midiMessages);
+		scheduler.schedule(span.end, track.noteOffMessages[noteOffIndex], span.trackIndex);
+	});
+}
+
+void PlaybackEngine::renderBlock(const Block& block, juce::MidiBuffer& midiMessages)
+{
+	if (snapshot == nullptr)
+	{
+		return;
+	}
+	releaseMutedTracks(midiMessages);
+	auto ticksPerQuarterNote = snapshot->ticksPerQuarterNote;
+	auto blockBegin = block.beginSample;
+	auto blockEnd = block.beginSample + block.numSamples;
+	auto hostTick = block.ppqPosition * ticksPerQuarterNote;
+	auto loopStart = (TickPosition)std::llround(block.ppqLoopStart * ticksPerQuarterNote);
+	auto loopEnd = (TickPosition)std::llround(block.ppqLoopEnd * ticksPerQuarterNote);
+	bool isLooping = block.isLooping && loopEnd > loopStart;
+	if (!isContinuous(hostTick))
+	{
+		sendAllNoteOff(midiMessages);
+		clock.anchor(hostTick, blockBegin, block.bpm, block.sampleRate);
+		bool isAtLoopStart = isLooping && std::abs(hostTick - (double)loopStart) <= MaxPositionDriftInTicks;
+		auto position = isAtLoopStart ? loopStart : clock.firstTickAt(blockBegin);
+		if (isAtLoopStart)
+		{
+			seekLoopStart(loopStart);
+		}
+		else
+		{
+			seek(position);
+		}
+		chaseChannelStates(0, midiMessages);
+		chaseSoundingNotes(position, 0, midiMessages);
+	}
+	else if (blockBegin != nextBlockBegin || !clock.hasTempo(block.bpm, block.sampleRate)
+		|| std::abs(hostTick - nextBlockBeginTick) > MaxPositionDriftInTicks)
+	{
+		// no jump, but the tempo, the host's sample timeline or the position changed.
+		// The host position is the reference: after a tempo change within the last block it is
+		// off from nextBlockBeginTick, events between the two are played at the block begin.
+		clock.anchor(hostTick, blockBegin, block.bpm, block.sampleRate);
+	}
+	// a loop shorter than one sample can not be played
+	isLooping = isLooping && clock.sampleAt(loopEnd) > clock.sampleAt(loopStart);
+	auto segmentBeginTick = clock.tickAt(blockBegin);
+	auto blockEndTick = clock.firstTickAt(blockEnd);
+	while (isLooping && segmentBeginTick < (double)loopEnd && blockEndTick > loopEnd)
+	{
+		// the block crosses the loop end: play up to the seam and go on at the loop start
+		renderUntil(loopEnd, blockBegin, midiMessages);
+		auto seam = clock.sampleAt(loopEnd);
+		auto seamOffset = (int)(seam - blockBegin);
+		flushNoteOffs(seamOffset, midiMessages);
+		clock.anchor((double)loopStart, seam, block.bpm, block.sampleRate);
+		seekLoopStart(loopStart);
+		chaseChannelStates(seamOffset, midiMessages);
+		chaseSoundingNotes(loopStart, seamOffset, midiMessages);
+		segmentBeginTick = (double)loopStart;
+		blockEndTick = clock.firstTickAt(blockEnd);
+	}
+	renderUntil(blockEndTick, blockBegin, midiMessages);
+	hasNextBlock = true;
+	nextBlockBegin = blockEnd;
+	nextBlockBeginTick = clock.tickAt(blockEnd);
+	nextBlockMaxDrift = std::max(MaxPositionDriftInTicks, getBlockLengthInTicks(block, ticksPerQuarterNote));
+}
+
+void PlaybackEngine::renderUntil(TickPosition until, SamplePosition blockBegin, juce::MidiBuffer& midiMessages)
+{
+	// idle tracks stay in the heap untouched, only tracks with an event in this range are visited
+	auto &heap = snapshot->mergeHeap;
+	while (!heap.empty() && heap.front().tickPosition < until)
+	{
+		std::pop_heap(heap.begin(), heap.end(), isLater);
+		auto trackIndex = heap.back().trackIndex;
+		heap.pop_back();
+		auto &eventIndex = snapshot->trackCursors[trackIndex];
+		++stats.tracksVisited;
+		if (!snapshot->isMuted(trackIndex))
+		{
+			emitEvent(trackIndex, eventIndex, blockBegin, midiMessages);
+		}
+		++eventIndex;
+		pushTrack(trackIndex);
+	}
+	emitNoteOffs(until, blockBegin, midiMessages);
+}
+
+void PlaybackEngine::emitEvent(size_t trackIndex, size_t eventIndex, SamplePosition blockBegin, juce::MidiBuffer& midiMessages)
+{
+	const auto &track = snapshot->tracks[trackIndex];
+	auto eventPosition = track.tickPositions[eventIndex];
+	// note offs and events arrive in time order, so the buffer only ever appends
+	emitNoteOffs(eventPosition + 1, blockBegin, midiMessages);
+	sendTrackEvent(trackIndex, eventIndex, toSampleOffset(eventPosition, blockBegin), midiMessages);
+	auto noteOffIndex = track.noteOffIndices[eventIndex];
+	if (noteOffIndex == TrackEvents::NoNoteOff)
+	{
+		return;
+	}
+	auto &scheduler = snapshot->noteOffScheduler;
+	if (scheduler.isFull())
+	{
+		// can not happen with the polyphony measured at compile time, but never allocate
+		sendNoteOff(scheduler.pop().noteOff, toSampleOffset(eventPosition, blockBegin), midiMessages);
+	}
+	scheduler.schedule(track.noteOffTickPositions[(size_t)noteOffIndex], track.noteOffMessages[(size_t)noteOffIndex], (juce::uint32)trackIndex);
+	stats.maxNoteOffQueueDepth = std::max(stats.maxNoteOffQueueDepth, (int)scheduler.size());
+}
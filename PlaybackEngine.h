@@ -0,0 +1,84 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include "PlaybackSnapshot.h"
+#include "TickClock.h"
+#include "ActiveNotes.h"
+
+/**
+ * Renders the events of a PlaybackSnapshot into midi blocks.
+ * Events are stored in ticks and scheduled against the host's musical
+ * position and tempo via a TickClock.
+ * Lives on the audio thread, none of its methods may block.
+ */
+class PlaybackEngine
+{
+public:
+	typedef TickClock::SamplePosition SamplePosition;
+	typedef TickClock::TickPosition TickPosition;
+	/// the half open sample range [beginSample, beginSample + numSamples)
+	struct Block
+	{
+		SamplePosition beginSample = 0;
+		int numSamples = 0;
+		double sampleRate = 0;
+		/// the host position at beginSample in quarter notes
+		double ppqPosition = 0;
+		double bpm = 0;
+		bool isLooping = false;
+		double ppqLoopStart = 0;
+		double ppqLoopEnd = 0;
+	};
+	struct Stats
+	{
+		int eventsEmitted = 0;
+		int tracksVisited = 0;
+		int maxNoteOffQueueDepth = 0;
+	};
+	/// the counters since the last call
+	Stats takeStats() { auto result = stats; stats = Stats(); return result; }
+	/// resets the playback state, `snapshot` may be null
+	void setSnapshot(PlaybackSnapshot* snapshot);
+	/// releases every sounding note and drops the scheduled note offs,
+	/// the next block is treated as a seek
+	void sendAllNoteOff(juce::MidiBuffer& midiMessages);
+	/// appends in time order behind the events already in `midiMessages`, so those must not be
+	/// later than sample 0 of the block, like the note offs of a snapshot swap or a transport stop
+	void renderBlock(const Block& block, juce::MidiBuffer& midiMessages);
+private:
+	bool isContinuous(double hostTick) const;
+	void seek(TickPosition position);
+	/// positions the cursors at the loop start, seeks only if the loop start has moved
+	void seekLoopStart(TickPosition loopStart);
+	void pushTrack(size_t trackIndex);
+	/// re-sends the program, controller and pitch bend state at the track cursors
+	void chaseChannelStates(int sampleOffset, juce::MidiBuffer& midiMessages);
+	/// starts the notes which began before `position` and are still sounding
+	void chaseSoundingNotes(TickPosition position, int sampleOffset, juce::MidiBuffer& midiMessages);
+	/// emits all events and note offs before `until`
+	void renderUntil(TickPosition until, SamplePosition blockBegin, juce::MidiBuffer& midiMessages);
+	void flushNoteOffs(int sampleOffset, juce::MidiBuffer& midiMessages);
+	/// sends the scheduled note offs of tracks muted since the last block
+	void releaseMutedTracks(juce::MidiBuffer& midiMessages);
+	/// every note on and note off goes through these two, to keep activeNotes up to date
+	void sendNoteOff(TrackEvents::PackedMessage noteOff, int sampleOffset, juce::MidiBuffer& midiMessages);
+	void sendTrackEvent(size_t trackIndex, size_t eventIndex, int sampleOffset, juce::MidiBuffer& midiMessages);
+	void emitEvent(size_t trackIndex, size_t eventIndex, SamplePosition blockBegin, juce::MidiBuffer& midiMessages);
+	/// sends every scheduled note off before `until`
+	void emitNoteOffs(TickPosition until, SamplePosition blockBegin, juce::MidiBuffer& midiMessages);
+	int toSampleOffset(TickPosition position, SamplePosition blockBegin) const;
+	PlaybackSnapshot* snapshot = nullptr;
+	TickClock clock;
+	ActiveNotes activeNotes;
+	unsigned seenMuteGeneration = 0;
+	Stats stats;
+	/// where the next block starts if the host keeps on playing
+	bool hasNextBlock = false;
+	SamplePosition nextBlockBegin = 0;
+	double nextBlockBeginTick = 0;
+	/// the host tempo may change within a block, so the host position may be off by up to a block length
+	double nextBlockMaxDrift = 0;
+	/// the loop start the cached cursors in the snapshot belong to
+	bool hasLoopStartCursors = false;
+	TickPosition loopStartCursorsPosition = 0;
+};
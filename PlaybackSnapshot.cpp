@@ -0,0 +1,349 @@
+#include "PlaybackSnapshot.h"
+#include <unordered_map>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iterator>
+
+namespace
+{
+	/// resolution used for midi files with smpte timing
+	const int DefaultTicksPerQuarterNote = 960;
+
+	TrackEvents::TickPosition toTickPosition(const juce::MidiMessage &message, double ticksPerTimestamp)
+	{
+		return (TrackEvents::TickPosition)std::llround(message.getTimeStamp() * ticksPerTimestamp);
+	}
+
+	double getTempoInSecondsPerQuarterNote(const juce::MidiFile &midiFile)
+	{
+		juce::MidiMessageSequence events;
+		midiFile.findAllTempoEvents(events);
+		if (events.getNumEvents() == 0)
+		{
+			return 0.5; // default is 120
+		}
+		// in werckmeister a piece has just one tempo event
+		return (*events.begin())->message.getTempoSecondsPerQuarterNote();
+	}
+
+	std::string findTrackName(const juce::MidiMessageSequence &track, std::unordered_map<std::string, int>& trackAppearances)
+	{
+		std::string trackName;
+		for (auto eventIt = track.begin(); eventIt != track.end(); ++eventIt)
+		{
+			const auto& midiMessage = (*eventIt)->message;
+			if (!midiMessage.isTrackNameEvent())
+			{
+				continue;
+			}
+			trackName = midiMessage.getTextFromTextMetaEvent().toStdString();
+			break;
+		}
+		if (trackName.empty())
+		{
+			trackName = std::string("Unnamed Track");
+		}
+		auto trackNameAppearanceIt = trackAppearances.find(trackName);
+		if (trackNameAppearanceIt == trackAppearances.end())
+		{
+			trackAppearances[trackName] = 1;
+		}
+		else
+		{
+			int trackCount = trackNameAppearanceIt->second + 1;
+			trackAppearances[trackName] = trackCount;
+			trackName = trackName + "(" + std::to_string(trackCount) + ")";
+		}
+		return trackName;
+	}
+
+	TrackEvents::PackedMessage pack(const juce::MidiMessage &message)
+	{
+		auto data = message.getRawData();
+		auto size = message.getRawDataSize();
+		TrackEvents::PackedMessage result = 0;
+		for (int i = 0; i < size && i < 3; ++i)
+		{
+			result |= (TrackEvents::PackedMessage)data[i] << (8 * i);
+		}
+		return result;
+	}
+
+	void createChaseStates(TrackEvents &track)
+	{
+		auto hasStateMessages = std::any_of(track.messages.begin(), track.messages.end(), ChannelStates::isStateMessage);
+		if (!hasStateMessages)
+		{
+			return;
+		}
+		track.chaseStates.reserve(track.size() / TrackEvents::ChaseInterval + 1);
+		ChannelStates channelStates;
+		for (size_t eventIndex = 0; eventIndex < track.size(); ++eventIndex)
+		{
+			if (eventIndex % TrackEvents::ChaseInterval == 0)
+			{
+				track.chaseStates.push_back(channelStates);
+			}
+			channelStates.apply(track.messages[eventIndex]);
+		}
+	}
+
+	/// moves a channel message to the routed channel
+	TrackEvents::PackedMessage route(TrackEvents::PackedMessage message, const TrackRouting &routing)
+	{
+		bool isChannelMessage = (message & 0x80) != 0 && (message & 0xF0) != 0xF0;
+		if (!isChannelMessage || routing.channel == TrackRouting::KeepChannel)
+		{
+			return message;
+		}
+		return (message & ~(TrackEvents::PackedMessage)0x0F) | (TrackEvents::PackedMessage)(routing.channel & 0x0F);
+	}
+
+	TrackEvents createTrackEvents(const juce::MidiMessageSequence &track, double ticksPerTimestamp, const TrackRouting &routing)
+	{
+		typedef juce::MidiMessageSequence::MidiEventHolder EventHolder;
+		TrackEvents result;
+		std::unordered_map<const EventHolder*, int> noteOffIndices;
+		for (auto eventIt = track.begin(); eventIt != track.end(); ++eventIt)
+		{
+			const auto& midiMessage = (*eventIt)->message;
+			if (!midiMessage.isNoteOff())
+			{
+				continue;
+			}
+			noteOffIndices[*eventIt] = (int)result.noteOffMessages.size();
+			result.noteOffTickPositions.push_back(toTickPosition(midiMessage, ticksPerTimestamp));
+			result.noteOffMessages.push_back(route(pack(midiMessage), routing));
+		}
+		auto numEvents = (size_t)track.getNumEvents() - result.noteOffMessages.size();
+		result.tickPositions.reserve(numEvents);
+		result.messages.reserve(numEvents);
+		result.noteOffIndices.reserve(numEvents);
+		for (auto eventIt = track.begin(); eventIt != track.end(); ++eventIt)
+		{
+			const auto& midiMessage = (*eventIt)->message;
+			if (midiMessage.isNoteOff() || midiMessage.isMetaEvent())
+			{
+				continue;
+			}
+			TrackEvents::PackedMessage packed;
+			if (midiMessage.isSysEx())
+			{
+				packed = 0xF0 | ((TrackEvents::PackedMessage)result.sysexMessages.size() << 8);
+				result.sysexMessages.push_back(midiMessage);
+			}
+			else
+			{
+				packed = route(pack(midiMessage), routing);
+			}
+			auto noteOffIndex = TrackEvents::NoNoteOff;
+			auto noteOffIt = noteOffIndices.find((*eventIt)->noteOffObject);
+			if (noteOffIt != noteOffIndices.end())
+			{
+				noteOffIndex = noteOffIt->second;
+			}
+			result.tickPositions.push_back(toTickPosition(midiMessage, ticksPerTimestamp));
+			result.messages.push_back(packed);
+			result.noteOffIndices.push_back(noteOffIndex);
+		}
+		createChaseStates(result);
+		return result;
+	}
+
+	NoteSpanIndex::NoteSpans getNoteSpans(const Tracks &tracks)
+	{
+		NoteSpanIndex::NoteSpans result;
+		for (size_t trackIndex = 0; trackIndex < tracks.size(); ++trackIndex)
+		{
+			const auto &track = tracks[trackIndex];
+			for (size_t eventIndex = 0; eventIndex < track.size(); ++eventIndex)
+			{
+				auto noteOffIndex = track.noteOffIndices[eventIndex];
+				if (noteOffIndex == TrackEvents::NoNoteOff)
+				{
+					continue;
+				}
+				result.push_back({ track.tickPositions[eventIndex], track.noteOffTickPositions[(size_t)noteOffIndex], (juce::uint32)trackIndex, (juce::uint32)eventIndex });
+			}
+		}
+		return result;
+	}
+
+	size_t getMaxPolyphony(const Tracks &tracks)
+	{
+		typedef std::pair<TrackEvents::TickPosition, int> NoteEdge;
+		std::vector<NoteEdge> edges;
+		for (const auto &track : tracks)
+		{
+			for (size_t eventIndex = 0; eventIndex < track.size(); ++eventIndex)
+			{
+				auto noteOffIndex = track.noteOffIndices[eventIndex];
+				if (noteOffIndex == TrackEvents::NoNoteOff)
+				{
+					continue;
+				}
+				edges.push_back({ track.tickPositions[eventIndex], 1 });
+				edges.push_back({ track.noteOffTickPositions[(size_t)noteOffIndex], -1 });
+			}
+		}
+		// at the same time stamp note offs (-1) come first
+		std::sort(edges.begin(), edges.end());
+		int polyphony = 0;
+		int maxPolyphony = 0;
+		for (const auto &edge : edges)
+		{
+			polyphony += edge.second;
+			maxPolyphony = std::max(maxPolyphony, polyphony);
+		}
+		return (size_t)maxPolyphony;
+	}
+}
+
+void TrackEvents::getChannelStatesAt(size_t eventIndex, ChannelStates &result) const
+{
+	if (chaseStates.empty())
+	{
+		result.reset();
+		return;
+	}
+	auto chaseIndex = std::min(eventIndex / ChaseInterval, chaseStates.size() - 1);
+	result = chaseStates[chaseIndex];
+	for (auto replayIndex = chaseIndex * ChaseInterval; replayIndex < eventIndex; ++replayIndex)
+	{
+		result.apply(messages[replayIndex]);
+	}
+}
+
+bool appendMidiEventMatchesAddEvent()
+{
+	const juce::uint8 sysex[] = { 0xF0, 0x7E, 0x7F, 0x09, 0x01, 0xF7 };
+	const juce::MidiMessage messages[] = 
+	{
+		juce::MidiMessage::noteOn(1, 60, (juce::uint8)100),
+		juce::MidiMessage::controllerEvent(2, 7, 90),
+		juce::MidiMessage(sysex, (int)sizeof(sysex)),
+		juce::MidiMessage::programChange(3, 5),
+		juce::MidiMessage::noteOff(1, 60),
+	};
+	const int sampleOffsets[] = { 0, 0, 17, 17, 511 };
+	juce::MidiBuffer appended;
+	juce::MidiBuffer added;
+	for (size_t i = 0; i < std::size(messages); ++i)
+	{
+		appendMidiEvent(appended, messages[i].getRawData(), messages[i].getRawDataSize(), sampleOffsets[i]);
+		added.addEvent(messages[i], sampleOffsets[i]);
+	}
+	return appended.data.size() == added.data.size()
+		&& std::memcmp(appended.data.begin(), added.data.begin(), (size_t)added.data.size()) == 0;
+}
+
+PlaybackSnapshotPtr createPlaybackSnapshot(CompiledSheetPtr compiledSheet, const PluginStateData::TrackRoutings &trackRoutings)
+{
+	auto snapshot = std::make_unique<PlaybackSnapshot>();
+	snapshot->compiledSheet = compiledSheet;
+	snapshot->ticksPerQuarterNote = DefaultTicksPerQuarterNote;
+	if (!compiledSheet)
+	{
+		return snapshot;
+	}
+	juce::MemoryInputStream fs(compiledSheet->midiData.data(), compiledSheet->midiData.size(), false);
+	juce::MidiFile midiFile;
+	midiFile.readFrom(fs);
+	snapshot->tempoInSecondsPerQuarterNote = getTempoInSecondsPerQuarterNote(midiFile);
+	double ticksPerTimestamp = 1;
+	auto timeFormat = midiFile.getTimeFormat();
+	if (timeFormat > 0)
+	{
+		snapshot->ticksPerQuarterNote = timeFormat;
+	}
+	else
+	{
+		// smpte timing: go via seconds and the sheet tempo
+		midiFile.convertTimestampTicksToSeconds();
+		ticksPerTimestamp = DefaultTicksPerQuarterNote / snapshot->tempoInSecondsPerQuarterNote;
+	}
+	auto numTracks = (size_t)midiFile.getNumTracks();
+	snapshot->tracks.resize(numTracks);
+	snapshot->trackNames.resize(numTracks);
+	snapshot->trackCursors.resize(numTracks, 0);
+	snapshot->mergeHeap.reserve(numTracks);
+	snapshot->loopStartCursors.resize(numTracks, 0);
+	snapshot->loopStartHeap.reserve(numTracks);
+	snapshot->mutedTracks = std::make_unique<std::atomic<bool>[]>(numTracks);
+	std::unordered_map<std::string, int> trackAppearances;
+	trackAppearances.reserve(numTracks);
+	for (size_t trackIdx = 0; trackIdx < numTracks; ++trackIdx)
+	{
+		auto track = midiFile.getTrack((int)trackIdx);
+		auto trackName = findTrackName(*track, trackAppearances);
+		TrackRouting routing;
+		auto routingIt = trackRoutings.find(trackName);
+		if (routingIt != trackRoutings.end())
+		{
+			routing = routingIt->second;
+		}
+		snapshot->tracks[trackIdx] = createTrackEvents(*track, ticksPerTimestamp, routing);
+		snapshot->trackNames[trackIdx] = trackName;
+		snapshot->mutedTracks[trackIdx].store(false, std::memory_order_relaxed);
+	}
+	snapshot->maxPolyphony = getMaxPolyphony(snapshot->tracks);
+	snapshot->noteOffScheduler.reserve(snapshot->maxPolyphony);
+	snapshot->noteSpans.build(getNoteSpans(snapshot->tracks));
+	return snapshot;
+}
+
+SnapshotExchange::~SnapshotExchange()
+{
+	collectGarbage();
+	delete _pending.exchange(nullptr);
+	delete _previous;
+	delete _current;
+}
+
+void SnapshotExchange::publish(PlaybackSnapshotPtr snapshot)
+{
+	collectGarbage();
+	_latest = snapshot.get();
+	// a snapshot still pending was never seen by the audio thread, so it can go right away
+	delete _pending.exchange(snapshot.release(), std::memory_order_acq_rel);
+}
+
+void SnapshotExchange::collectGarbage()
+{
+	auto snapshot = _retired.exchange(nullptr, std::memory_order_acquire);
+	while (snapshot != nullptr)
+	{
+		auto next = snapshot->nextRetired;
+		delete snapshot;
+		snapshot = next;
+	}
+}
+
+PlaybackSnapshot* SnapshotExchange::acquire()
+{
+	retire(_previous);
+	_previous = nullptr;
+	auto next = _pending.exchange(nullptr, std::memory_order_acq_rel);
+	if (next == nullptr)
+	{
+		return _current;
+	}
+	_previous = _current;
+	_current = next;
+	return _current;
+}
+
+void SnapshotExchange::retire(PlaybackSnapshot* snapshot)
+{
+	if (snapshot == nullptr)
+	{
+		return;
+	}
+	// single producer (the audio thread) and the consumer takes the whole list at once, so no ABA
+	auto head = _retired.load(std::memory_order_relaxed);
+	do
+	{
+		snapshot->nextRetired = head;
+	} while (!_retired.compare_exchange_weak(head, snapshot, std::memory_order_release, std::memory_order_relaxed));
+}
@@ -0,0 +1,179 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "CompiledSheet.h"
+#include "PluginStateData.h"
+#include "NoteOffScheduler.h"
+#include "ChannelStates.h"
+#include "NoteSpanIndex.h"
+
+/**
+ * The playable events of one midi track, flattened into contiguous arrays
+ * so the block scan is a linear pass over dense memory.
+ * Note offs are not part of the scan, a note on refers to its note off
+ * via `noteOffIndices`. Times are midi ticks, so they do not depend on the
+ * host tempo or sample rate.
+ */
+struct TrackEvents
+{
+	/// status byte | data1 << 8 | data2 << 16; a sysex is stored as 0xF0 | sysexIndex << 8
+	typedef NoteOffScheduler::PackedMessage PackedMessage;
+	typedef NoteOffScheduler::TickPosition TickPosition;
+	typedef std::vector<TickPosition> TickPositions;
+	typedef std::vector<PackedMessage> Messages;
+	typedef std::vector<int> NoteOffIndices;
+	typedef std::vector<juce::MidiMessage> SysexMessages;
+	typedef std::vector<ChannelStates> ChaseStates;
+	static const int NoNoteOff = -1;
+	/// events between two chase states
+	static const size_t ChaseInterval = 256;
+	TickPositions tickPositions;
+	Messages messages;
+	NoteOffIndices noteOffIndices;
+	TickPositions noteOffTickPositions;
+	Messages noteOffMessages;
+	SysexMessages sysexMessages;
+	/// the channel states before event i * ChaseInterval, empty if the track has no state messages
+	ChaseStates chaseStates;
+	size_t size() const { return tickPositions.size(); }
+	/// index of the first event at or after `position`, O(log n)
+	size_t seek(TickPosition position) const { return (size_t)(std::lower_bound(tickPositions.begin(), tickPositions.end(), position) - tickPositions.begin()); }
+	void addEventTo(juce::MidiBuffer &buffer, size_t eventIndex, int sampleOffset) const;
+	/// the channel states right before `eventIndex`: a copy of the preceding chase state
+	/// and a replay of less than ChaseInterval events, so it does not allocate
+	void getChannelStatesAt(size_t eventIndex, ChannelStates &result) const;
+};
+typedef std::vector<TrackEvents> Tracks;
+
+/**
+ * Appends an event behind the last one of `buffer`, which must not be later than `sampleOffset`.
+ * MidiBuffer::addEvent searches the insert position from the front, which makes a block
+ * quadratic in its number of events; the engine writes in time order and can simply append.
+ * Uses the layout of MidiBuffer::data: int32 sample position, uint16 size, message bytes.
+ */
+inline void appendMidiEvent(juce::MidiBuffer &buffer, const juce::uint8 *bytes, int numBytes, int sampleOffset)
+{
+	const auto sampleNumber = (juce::int32)sampleOffset;
+	const auto size = (juce::uint16)numBytes;
+	auto &data = buffer.data;
+	auto position = data.size();
+	data.resize(position + (int)(sizeof(sampleNumber) + sizeof(size)) + numBytes);
+	auto dest = data.getRawDataPointer() + position;
+	std::memcpy(dest, &sampleNumber, sizeof(sampleNumber));
+	std::memcpy(dest + sizeof(sampleNumber), &size, sizeof(size));
+	std::memcpy(dest + sizeof(sampleNumber) + sizeof(size), bytes, (size_t)numBytes);
+}
+static_assert(std::is_same<decltype(juce::MidiBuffer::data), juce::Array<juce::uint8>>::value,
+	"appendMidiEvent writes the raw layout of MidiBuffer::data");
+
+/// debug check against a juce update: appendMidiEvent and MidiBuffer::addEvent
+/// produce the same bytes for events in time order, sysex and ties included
+bool appendMidiEventMatchesAddEvent();
+
+inline void addPackedMessage(juce::MidiBuffer &buffer, TrackEvents::PackedMessage message, int sampleOffset)
+{
+	const juce::uint8 bytes[3] = { (juce::uint8)(message & 0xFF), (juce::uint8)((message >> 8) & 0xFF), (juce::uint8)((message >> 16) & 0xFF) };
+	appendMidiEvent(buffer, bytes, juce::MidiMessage::getMessageLengthFromFirstByte(bytes[0]), sampleOffset);
+}
+
+inline void TrackEvents::addEventTo(juce::MidiBuffer &buffer, size_t eventIndex, int sampleOffset) const
+{
+	auto message = messages[eventIndex];
+	if ((message & 0xFF) == 0xF0)
+	{
+		const auto &sysex = sysexMessages[message >> 8];
+		appendMidiEvent(buffer, sysex.getRawData(), sysex.getRawDataSize(), sampleOffset);
+		return;
+	}
+	addPackedMessage(buffer, message, sampleOffset);
+}
+
+/// the next pending event of a track, see PlaybackEngine
+struct MergeHeapItem
+{
+	TrackEvents::TickPosition tickPosition;
+	size_t trackIndex;
+};
+typedef std::vector<MergeHeapItem> MergeHeap;
+
+/**
+ * Everything processBlock() needs to play a compiled sheet.
+ * A snapshot is built completely on a non realtime thread and handed over
+ * to the audio thread via SnapshotExchange. After publishing, only the
+ * audio thread touches the playback state; the event data stays immutable.
+ */
+struct PlaybackSnapshot
+{
+	typedef std::vector<std::string> TrackNames;
+	typedef std::vector<size_t> TrackCursors;
+	typedef std::unique_ptr<std::atomic<bool>[]> MutedFlags;
+	CompiledSheetPtr compiledSheet;
+	Tracks tracks;
+	TrackNames trackNames;
+	double tempoInSecondsPerQuarterNote = 0.5;
+	int ticksPerQuarterNote = 0;
+	/// the most notes sounding at the same time, over all tracks
+	size_t maxPolyphony = 0;
+	/// the notes of all tracks, to start the ones already sounding at a seek
+	NoteSpanIndex noteSpans;
+	/// written by the message thread, read by the audio thread
+	MutedFlags mutedTracks;
+	/// incremented after a change of mutedTracks
+	std::atomic<unsigned> muteGeneration { 0 };
+	/// audio thread only: index of the next event to look at per track
+	TrackCursors trackCursors;
+	/// audio thread only: capacity for every track is reserved up front
+	MergeHeap mergeHeap;
+	/// audio thread only: cursors and heap at the host's loop start, see PlaybackEngine
+	TrackCursors loopStartCursors;
+	MergeHeap loopStartHeap;
+	/// audio thread only: sized by maxPolyphony
+	NoteOffScheduler noteOffScheduler;
+	/// audio thread only: scratch space for chasing the channel states
+	ChannelStates chaseStates;
+	/// intrusive link for the retired list, see SnapshotExchange
+	PlaybackSnapshot* nextRetired = nullptr;
+	size_t numTracks() const { return tracks.size(); }
+	bool isMuted(size_t trackIndex) const { return mutedTracks[trackIndex].load(std::memory_order_relaxed); }
+};
+typedef std::unique_ptr<PlaybackSnapshot> PlaybackSnapshotPtr;
+
+/// `trackRoutings` are looked up by track name and resolved into the snapshot
+PlaybackSnapshotPtr createPlaybackSnapshot(CompiledSheetPtr compiledSheet, const PluginStateData::TrackRoutings &trackRoutings);
+
+/**
+ * Hands snapshots from the compiler side to the audio thread without locks.
+ * publish() may be called from any non realtime thread (but not concurrently),
+ * acquire() only from the audio thread. Replaced snapshots are never deleted by the audio thread,
+ * it pushes them onto a retired list which is freed by collectGarbage().
+ */
+class SnapshotExchange
+{
+public:
+	SnapshotExchange() = default;
+	~SnapshotExchange();
+	/// non realtime: makes `snapshot` the one to play next
+	void publish(PlaybackSnapshotPtr snapshot);
+	/// non realtime: the most recently published snapshot, valid until the next publish()
+	PlaybackSnapshot* latest() const { return _latest; }
+	/// non realtime: frees every snapshot the audio thread has let go
+	void collectGarbage();
+	/// audio thread: returns the snapshot to play, picks up a pending one if there is any.
+	/// A replaced snapshot stays valid until the next call, so it can still be flushed.
+	PlaybackSnapshot* acquire();
+private:
+	void retire(PlaybackSnapshot* snapshot);
+	std::atomic<PlaybackSnapshot*> _pending { nullptr };
+	std::atomic<PlaybackSnapshot*> _retired { nullptr };
+	PlaybackSnapshot* _current = nullptr;
+	PlaybackSnapshot* _previous = nullptr;
+	PlaybackSnapshot* _latest = nullptr;
+	JUCE_DECLARE_NON_COPYABLE(SnapshotExchange)
+};
@@ -10,6 +10,11 @@ extern "C" {
 
 #define LOCK(mutex) std::lock_guard<Mutex> guard(mutex)
 
+namespace
+{
+    const int AudioThreadStatusIntervalMillis = 500;
+}
+
 PluginEditor::PluginEditor (PluginProcessor& p)
     : AudioProcessorEditor (&p), processorRef (p)
 {
@@ -49,6 +54,7 @@ PluginEditor::PluginEditor (PluginProcessor& p)
     trackFilterView.setViewedComponent(&trackFilter, false);
     trackFilter.setBounds(5, 60, getWidth() - 5 - 5, 92);
     trackFilter.onFilterChanged = std::bind(&PluginEditor::onTrackFilterChanged, this, std::placeholders::_1, std::placeholders::_2);
+    trackFilter.onItemMenu = std::bind(&PluginEditor::showTrackRoutingMenu, this, std::placeholders::_1);
     trackFilterView.setBounds(5, 60, getWidth() - 5 - 5, 100);
     addAndMakeVisible(trackFilterView);
 
@@ -63,6 +69,12 @@ PluginEditor::PluginEditor (PluginProcessor& p)
     console.setColour(juce::TextEditor::ColourIds::backgroundColourId, juce::Colour((juce::uint8)0, (juce::uint8)0, (juce::uint8)0, (juce::uint8)150));
     addAndMakeVisible(console);
 
+    //
+    audioThreadStatus.setBounds(5, getHeight() - 30, getWidth() - 5 - 5, 25);
+    audioThreadStatus.setFont(font);
+    addAndMakeVisible(audioThreadStatus);
+    startTimer(AudioThreadStatusIntervalMillis);
+
     //
     writeLine(juce::String("Werckmeister VST ") + JucePlugin_VersionString);
     const auto &processorlogCache = processorRef.getLogCache();
@@ -76,15 +88,43 @@ void PluginEditor::onTrackFilterChanged(int trackIndex, bool filterValue)
     processorRef.onTrackFilterChanged(trackIndex, filterValue);
 }
 
+void PluginEditor::showTrackRoutingMenu(int trackIndex)
+{
+    auto routing = processorRef.getTrackRouting(trackIndex);
+    auto setChannel = [this, trackIndex, routing](int channel)
+    {
+        auto newRouting = routing;
+        newRouting.channel = channel;
+        processorRef.setTrackRouting(trackIndex, newRouting);
+    };
+    juce::PopupMenu channelMenu;
+    channelMenu.addItem("Keep", true, routing.channel == TrackRouting::KeepChannel, [setChannel]() { setChannel(TrackRouting::KeepChannel); });
+    for (int channel = 0; channel < 16; ++channel)
+    {
+        channelMenu.addItem("Channel " + juce::String(channel + 1), true, routing.channel == channel, [setChannel, channel]() { setChannel(channel); });
+    }
+    juce::PopupMenu menu;
+    menu.addSubMenu("Midi Channel", channelMenu);
+    menu.showMenuAsync(juce::PopupMenu::Options());
+}
+
 void PluginEditor::tracksChanged()
 {
-    trackFilter.setItems(processorRef.trackNames);
+    auto trackStates = processorRef.getTrackStates();
+    trackFilter.setItems(trackStates.trackNames);
     this->setBounds(getBounds());
-    setFilterStates();
+    setFilterStates(trackStates.mutedTracks);
 }
 
 PluginEditor::~PluginEditor()
 {
+    stopTimer();
+}
+
+void PluginEditor::timerCallback()
+{
+    processorRef.getAudioThreadMonitor().collect(audioThreadSummary);
+    audioThreadStatus.setText(audioThreadSummary.toString(), juce::dontSendNotification);
 }
 
 void PluginEditor::paint(juce::Graphics& g)
@@ -114,7 +154,7 @@ void PluginEditor::selectSheetFile()
     myChooser->launchAsync (folderChooserFlags, [this] (const FileChooser& chooser)
     {
         File sheetFile (chooser.getResult());
-        processorRef.compile(sheetFile.getFullPathName());
+        processorRef.requestCompile(sheetFile.getFullPathName());
     }); 
 }
 
@@ -139,11 +179,11 @@ void PluginEditor::writeLine(const juce::String& line)
     triggerAsyncUpdate();
 }
 
-void PluginEditor::setFilterStates()
+void PluginEditor::setFilterStates(const PluginProcessor::MutedTracks &mutedTracks)
 {
     for (size_t trackIndex = 0; trackIndex < trackFilter.getItems().size(); ++trackIndex)
     {
-        auto state = !processorRef.isMuted((int)trackIndex);
+        auto state = mutedTracks.find((int)trackIndex) == mutedTracks.end();
         trackFilter.setItemState((int)trackIndex, state);
     }
 }
@@ -9,7 +9,7 @@
 #include <string>
 
 //==============================================================================
-class PluginEditor  : public juce::AudioProcessorEditor, public juce::AsyncUpdater
+class PluginEditor  : public juce::AudioProcessorEditor, public juce::AsyncUpdater, public juce::Timer
 {
 public:
     explicit PluginEditor (PluginProcessor&);
@@ -21,6 +21,7 @@ public:
     virtual void writeLine(const juce::String&);
     void tracksChanged();
     void handleAsyncUpdate() override;
+    void timerCallback() override;
 private:
     std::list<std::string> logCache;
     bool tracksAreDirty = false;
@@ -28,6 +29,8 @@ private:
     Mutex logMutex;
     std::unique_ptr<juce::FileChooser> myChooser;
     juce::TextEditor console;
+    juce::Label audioThreadStatus;
+    AudioThreadMonitor::Summary audioThreadSummary;
     juce::TextButton findSheetFileBtn;
     juce::TextButton recompileBtn;
     juce::ImageButton preferences;
@@ -40,6 +43,7 @@ private:
     void recompile();
     void showPreferences();
     void onTrackFilterChanged(int trackIndex, bool filterValue);
-    void setFilterStates();
+    void setFilterStates(const PluginProcessor::MutedTracks &mutedTracks);
+    void showTrackRoutingMenu(int trackIndex);
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PluginEditor)
 };
@@ -1,6 +1,9 @@
 #include <iostream>
 #include <ctime>
 #include "PluginEditor.h"
+#include "CompileCache.h"
+#include "CompileLock.h"
+#include "CompilerRegistry.h"
 #include "PluginProcessor.h"
 #include <algorithm>
 #include "Preferences.h"
@@ -24,11 +27,16 @@ PluginProcessor::PluginProcessor()
 {
 	fileWatcher.startThread();
 	fileWatcher.onFileChanged = std::bind(&PluginProcessor::reCompile, this);
+	compileWorker.onCompile = std::bind(&PluginProcessor::onCompileRequest, this, std::placeholders::_1, std::placeholders::_2);
+	compileWorker.startThread();
 	initCompiler();
+	jassert(appendMidiEventMatchesAddEvent());
 }
 
 PluginProcessor::~PluginProcessor()
 {
+	compileWorker.stopThread(CompileWorker::THREAD_IDLE_TIME * 100);
+	cancelPendingUpdate();
 	stopUdpSender();
 	fileWatcher.stopThread(FileWatcher::THREAD_IDLE_TIME * 2);
 }
@@ -100,6 +108,8 @@ void PluginProcessor::changeProgramName(int, const juce::String&)
 
 void PluginProcessor::prepareToPlay(double, int)
 {
+	midiOutput.ensureSize(MidiOutputReserveInBytes);
+	mergedMidiOutput.ensureSize(MidiOutputReserveInBytes * 2);
 }
 
 
@@ -122,27 +132,80 @@ bool PluginProcessor::isBusesLayoutSupported(const BusesLayout& layouts) const
 #endif
 }
 
-void PluginProcessor::sendAllNoteOff(juce::MidiBuffer& midiMessages)
-{
-	for (NoteOffStack::iterator it = noteOffStack.begin(); it != noteOffStack.end(); ++it)
-	{
-		midiMessages.addEvent(it->noteOff, 0);
-	}
-	noteOffStack.clear();
-}
-
 void PluginProcessor::processBlock(juce::AudioBuffer<float>& buffer,
 	juce::MidiBuffer& midiMessages)
 {
 	juce::ScopedNoDenormals noDenormals;
+	audioThreadMonitor.beginBlock();
 	auto totalNumOutputChannels = getTotalNumOutputChannels();
 	for (auto i = 0; i < totalNumOutputChannels; ++i)
 	{
 		buffer.clear(i, 0, buffer.getNumSamples());
 	}
-	processNoteOffStack(midiMessages);
-	LOCK(processMutex);
-	if(_midiFile.getNumTracks() == 0)
+	renderMidi(buffer);
+	mergeMidiOutput(midiMessages);
+	auto engineStats = playbackEngine.takeStats();
+	AudioThreadMonitor::BlockStats stats;
+	stats.eventsEmitted = engineStats.eventsEmitted;
+	stats.tracksVisited = engineStats.tracksVisited;
+	stats.noteOffQueueDepth = engineStats.maxNoteOffQueueDepth;
+	audioThreadMonitor.endBlock(stats, buffer.getNumSamples(), getSampleRate());
+}
+
+void PluginProcessor::mergeMidiOutput(juce::MidiBuffer& midiMessages)
+{
+	// a linear merge of the host's input and the rendered events, on ties the input comes first
+	if (midiOutput.isEmpty())
+	{
+		return;
+	}
+	auto &merged = mergedMidiOutput;
+	if (midiMessages.isEmpty())
+	{
+		merged.swapWith(midiOutput);
+	}
+	else
+	{
+		auto inputIt = midiMessages.begin();
+		auto outputIt = midiOutput.begin();
+		while (inputIt != midiMessages.end() || outputIt != midiOutput.end())
+		{
+			bool takeInput = outputIt == midiOutput.end()
+				|| (inputIt != midiMessages.end() && (*inputIt).samplePosition <= (*outputIt).samplePosition);
+			auto &position = takeInput ? inputIt : outputIt;
+			auto event = *position;
+			appendMidiEvent(merged, event.data, event.numBytes, event.samplePosition);
+			++position;
+		}
+	}
+	// offline and realtime merge the same way, only the hand-over differs
+	if (isNonRealtime())
+	{
+		// a bounce may produce huge buffers, hand them over instead of copying.
+		// Our buffer gets the host's storage in exchange and may grow in the next block
+		midiMessages.swapWith(merged);
+	}
+	else
+	{
+		// copying keeps our buffers and their reserved storage, but the host's buffer
+		// still allocates if the merged events exceed its capacity
+		midiMessages.data.clearQuick();
+		midiMessages.data.addArray(merged.data.begin(), merged.data.size());
+	}
+	merged.clear();
+	midiOutput.clear();
+}
+
+void PluginProcessor::renderMidi(const juce::AudioBuffer<float>& buffer)
+{
+	auto snapshot = snapshotExchange.acquire();
+	if (snapshot != playingSnapshot)
+	{
+		playingSnapshot = snapshot;
+		playbackEngine.sendAllNoteOff(midiOutput);
+		playbackEngine.setSnapshot(snapshot);
+	}
+	if (snapshot == nullptr || snapshot->numTracks() == 0)
 	{
 		return;
 	}
@@ -152,101 +215,36 @@ void PluginProcessor::processBlock(juce::AudioBuffer<float>& buffer,
 	}
 	juce::AudioPlayHead::CurrentPositionInfo posInfo = {0};
 	playHead_->getCurrentPosition(posInfo);
-	if (udpSender)
+	PlaybackEngine::Block block;
+	block.beginSample = posInfo.timeInSamples;
+	block.numSamples = buffer.getNumSamples();
+	block.sampleRate = getSampleRate();
+	bool hostHasTempo = posInfo.bpm > 0;
+	if (hostHasTempo)
+	{
+		block.bpm = posInfo.bpm;
+		block.ppqPosition = posInfo.ppqPosition;
+		block.isLooping = posInfo.isLooping;
+		block.ppqLoopStart = posInfo.ppqLoopStart;
+		block.ppqLoopEnd = posInfo.ppqLoopEnd;
+	}
+	else
 	{
-		udpSender->currentTimeInQuarters = posInfo.timeInSeconds / currentSheetTempoInSecondsPerQuarterNote;
+		// no musical time from the host, play with the tempo of the sheet
+		block.bpm = 60.0 / snapshot->tempoInSecondsPerQuarterNote;
+		block.ppqPosition = posInfo.timeInSeconds / snapshot->tempoInSecondsPerQuarterNote;
 	}
+	currentTimeInQuarters.store(block.ppqPosition, std::memory_order_relaxed);
 	if (!posInfo.isPlaying && _lastIsPlayingState) 
 	{
 		_lastIsPlayingState = false;
-		sendAllNoteOff(midiMessages);
+		playbackEngine.sendAllNoteOff(midiOutput);
 	}
 	if (!posInfo.isPlaying) {
 		return;
 	}
 	_lastIsPlayingState = true;
-	auto beginPosSeconds = posInfo.timeInSeconds;
-	auto endPosSeconds = posInfo.timeInSeconds + ((double)getBlockSize() / getSampleRate());
-
-	for (size_t trackIdx = 0; trackIdx < (size_t)_midiFile.getNumTracks(); ++trackIdx)
-	{
-		if (isMuted(trackIdx))
-		{
-			continue;
-		}
-		auto track = _midiFile.getTrack((int)trackIdx);
-		if (track->getNumEvents() == 0) 
-		{
-			continue;
-		}
-		auto eventIt = _iteratorTrackMap[trackIdx];
-		if (eventIt == track->end())  
-		{
-			eventIt = track->begin();
-		}
-		bool playHeadIsBeforeCurrentIterator = beginPosSeconds < (*eventIt)->message.getTimeStamp();
-		if (playHeadIsBeforeCurrentIterator) 
-		{
-			eventIt = track->begin();
-		}
-		while (true) {
-			if (eventIt == track->end())
-			{
-				break;
-			}
-			const auto &midiMessage = (*eventIt)->message;
-			auto eventTimeStamp = midiMessage.getTimeStamp();
-			if (eventTimeStamp > endPosSeconds)
-			{
-				break;
-			}
-			int sampleOffset = std::max<double>(0.0, (eventTimeStamp - beginPosSeconds) * getSampleRate());
-			bool isSendMessage = !midiMessage.isNoteOff() && (eventTimeStamp >= beginPosSeconds && eventTimeStamp <= endPosSeconds);
-			if (isSendMessage) 
-			{
-				midiMessages.addEvent(midiMessage, (int)sampleOffset);
-				auto corrospondingNoteOff = (*eventIt)->noteOffObject;
-				if (corrospondingNoteOff)
-				{
-					const auto &noteOffMidiMessage = corrospondingNoteOff->message;
-					auto noteOffSampleOffset = noteOffMidiMessage.getTimeStamp() * getSampleRate();
-					noteOffSampleOffset -= eventTimeStamp * getSampleRate();
-					if (noteOffSampleOffset < getBlockSize()) 
-					{
-						midiMessages.addEvent(noteOffMidiMessage, (int)noteOffSampleOffset);
-					}
-					else
-					{
-						NoteOffStackItem noteOff = {noteOffMidiMessage, (int)noteOffSampleOffset};
-						noteOffStack.emplace_back(noteOff);
-					}
-				}
-			}
-			++eventIt;
-		}
-		_iteratorTrackMap[trackIdx] = eventIt;
-	}
-}
-
-void PluginProcessor::processNoteOffStack(juce::MidiBuffer& midiMessages)
-{
-	int blockSize_ = getBlockSize();
-	std::list<NoteOffStack::iterator> toRemove;
-	for(NoteOffStack::iterator it = noteOffStack.begin(); it != noteOffStack.end(); ++it)
-	{
-		it->offsetInSamples -= blockSize_;
-		if (it->offsetInSamples > blockSize_)
-		{
-			continue;
-		}
-		midiMessages.addEvent(it->noteOff, it->offsetInSamples);
-		toRemove.push_back(it);
-	}
-
-	for (auto it : toRemove)
-	{
-		noteOffStack.erase(it);
-	}  
+	playbackEngine.renderBlock(block, midiOutput);
 }
 
 bool PluginProcessor::hasEditor() const
@@ -266,18 +264,52 @@ void PluginProcessor::getStateInformation(juce::MemoryBlock& destData)
 
 void PluginProcessor::setStateInformation(const void* data, int sizeInBytes)
 {
-	pluginStateData = readStateData(data, sizeInBytes);
-	if (!pluginStateData.isValid)
+	auto stateData = readStateData(data, sizeInBytes);
+	if (!stateData.isValid)
+	{
+		return;
+	}
+	LOCK(compileMutex);
+	pluginStateData = stateData;
+	compileWorker.requestCompile({ pluginStateData.sheetPath, true });
+}
+
+void PluginProcessor::onCompileRequest(const CompileWorker::Request& request, const CompileWorker::CancelCheck& isCancelled)
+{
+	auto succeeded = compile(request.sheetPath, isCancelled);
+	if (!succeeded && !isCancelled() && request.watchSheetOnFailure && !request.sheetPath.empty())
+	{
+		LOCK(compileMutex);
+		fileWatcher.setFileList({request.sheetPath});
+		startUdpSender(request.sheetPath);
+	}
+}
+
+void PluginProcessor::requestCompile(const juce::String& path)
+{
+	compileWorker.requestCompile({ path.toStdString(), false });
+}
+
+void PluginProcessor::handleAsyncUpdate()
+{
+	LogCache logLines;
+	{
+		std::lock_guard<Mutex> guard(logMutex);
+		logLines.swap(pendingLogLines);
+	}
+	auto editor = dynamic_cast<PluginEditor*>(getActiveEditor());
+	if (editor == nullptr)
 	{
+		logCache.splice(logCache.end(), logLines);
 		return;
 	}
-	auto succeeded = compile(pluginStateData.sheetPath);
-	if (!succeeded && pluginStateData.sheetPath.empty() == false) 
+	for (const auto &line : logLines)
 	{
-		LOCK(processMutex);
-		fileWatcher.setFileList({pluginStateData.sheetPath});
-		int port = readPreferencesData().funkfeuerPort;
-		startUdpSender(pluginStateData.sheetPath);
+		editor->writeLine(juce::String(line));
+	}
+	if (tracksHaveChanged.exchange(false))
+	{
+		editor->tracksChanged();
 	}
 }
 
@@ -288,7 +320,8 @@ juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter()
 
 void PluginProcessor::reCompile()
 {
-	compile(pluginStateData.sheetPath);
+	LOCK(compileMutex);
+	compileWorker.requestCompile({ pluginStateData.sheetPath, false });
 }
 
 void PluginProcessor::updateFileWatcher(const CompiledSheet& sheet)
@@ -304,39 +337,15 @@ void PluginProcessor::updateFileWatcher(const CompiledSheet& sheet)
 	fileWatcher.setFileList(filesToWatch);
 }
 
-namespace 
+void PluginProcessor::initCompiler()
 {
-	// https://onlinegdb.com/aPPpWOYyd
-	int parseVersionNumber(const std::string &versionStr)
-	{
-		if (versionStr.empty())
-		{
-			return 0;
-		}
-		int base = 10000;
-		int version = 0;
-		for(char ch : versionStr) 
-		{
-			if(ch == '.') 
-			{
-				continue;
-			}
-			if (ch < '0' || ch > '9') 
-			{
-				break;
-			}
-			version += (ch - '0') * base;
-			base /= 10;
-		}
-		return version;
-	}
+	compileWorker.post(std::bind(&PluginProcessor::findCompiler, this));
 }
 
-void PluginProcessor::initCompiler()
+void PluginProcessor::findCompiler()
 {
-	Compiler compiler(*this);
-	compiler.resetExecutablePath();
-	auto version = compiler.getVersionStr();
+	auto compilerInfo = CompilerRegistry::getInstance().getCompiler();
+	const auto &version = compilerInfo.version;
 	if (version.empty()) 
 	{
 		error(LogLambda(log << "The werckmeister compiler could not be found."));
@@ -346,7 +355,7 @@ void PluginProcessor::initCompiler()
 		compilerIsReady = false;
 		return;
 	}
-	if (parseVersionNumber(version) < MinWerckmeisterVersion) 
+	if (compilerInfo.versionNumber < MinWerckmeisterVersion) 
 	{
 		error(LogLambda(log << "The installed werckmeister version '" << version << "' is not supported by this plugin."));
 		info(LogLambda(log << "You need weckmeister >= " << MinWerckmeisterVersionStr << "."));
@@ -355,11 +364,12 @@ void PluginProcessor::initCompiler()
 		compilerIsReady = false;
 		return;
 	}
-	info(LogLambda(log << "Compiler: " << compiler.compilerExecutable() << " -- " << version));
+	info(LogLambda(log << "Compiler: " << compilerInfo.id()));
+	compilerId = compilerInfo.id();
 	compilerIsReady = true;
 }
 
-bool PluginProcessor::compile(const juce::String& path)
+bool PluginProcessor::compile(const juce::String& path, const Compiler::CancelCheck& isCancelled)
 {
 	if (!compilerIsReady)
 	{
@@ -373,51 +383,95 @@ bool PluginProcessor::compile(const juce::String& path)
 	{
 		return false;
 	}
-	Compiler compiler(*this);
-	auto compilerResult = compiler.compile(path.toStdString());
-	pluginStateData.sheetPath = path.toStdString();
+	CompileCache compileCache(compilerId);
+	auto compilerResult = compileCache.load(path.toStdString());
+	bool isCached = compilerResult != nullptr;
+	if (isCached)
+	{
+		info(LogLambda(log << "\"" << path.toStdString() << "\" is unchanged, using the cached compile"));
+	}
+	else
+	{
+		// other processes loading the same sheet wait here and take the cached result
+		CompileLock compileLock(compilerId, path.toStdString());
+		compileLock.acquire(isCancelled);
+		if (compileLock.hadToWait() && !isCancelled())
+		{
+			compilerResult = compileCache.load(path.toStdString());
+			isCached = compilerResult != nullptr;
+		}
+		CompileCache::FileHashes sourceHashes;
+		if (!isCached && !isCancelled())
+		{
+			// hashed before the compiler reads them, an edit made while it runs must not end up in the cache
+			sourceHashes = compileCache.hashKnownSources(path.toStdString());
+			Compiler compiler(*this);
+			compilerResult = compiler.compile(path.toStdString(), isCancelled);
+		}
+		if (compilerResult && !isCached && !isCancelled())
+		{
+			// still holding the lock, so the waiting processes find the entry
+			compileCache.store(path.toStdString(), *compilerResult, sourceHashes);
+		}
+	}
+	if (isCancelled())
+	{
+		// a newer request is waiting, its result will replace this one anyway
+		return false;
+	}
+	PluginStateData::TrackRoutings trackRoutings;
+	{
+		LOCK(compileMutex);
+		trackRoutings = pluginStateData.trackRoutings;
+	}
+	// everything the audio thread needs is prepared before anything gets locked
+	auto snapshot = createPlaybackSnapshot(compilerResult, trackRoutings);
 	stopUdpSender();
-	LOCK(processMutex);
-	_midiFile.clear();
-	_iteratorTrackMap.clear();
+	LOCK(compileMutex);
+	pluginStateData.sheetPath = path.toStdString();
 	mutedTracks.clear();
 	if (!compilerResult)
 	{
+		snapshotExchange.publish(std::move(snapshot));
 		return false;
 	}
 	compiledSheet = compilerResult;
-	juce::MemoryInputStream fs(compiledSheet->midiData.data(), compiledSheet->midiData.size(), false);
-	_midiFile.readFrom(fs);
-	_midiFile.convertTimestampTicksToSeconds();
-	auto numTracks = (size_t)_midiFile.getNumTracks();
-	_iteratorTrackMap.resize(numTracks);
-	trackNames.resize(numTracks);
-	std::unordered_map<std::string, int> trackAppearances;
-	trackAppearances.reserve((size_t)_midiFile.getNumTracks());
-	for (size_t trackIdx = 0; trackIdx < numTracks; ++trackIdx)
-	{
-		auto track = _midiFile.getTrack((int)trackIdx);
-		_iteratorTrackMap[trackIdx] = track->begin();
-		findTrackName(trackIdx, trackAppearances);
-		applyMutedTrackState(trackIdx);
-	}
-	currentSheetTempoInSecondsPerQuarterNote = getTempoInSecondsPerQuarterNote(_midiFile);
-	auto editor = dynamic_cast<PluginEditor*>(getActiveEditor());
-	if (editor != nullptr)
+	trackNames = snapshot->trackNames;
+	for (size_t trackIdx = 0; trackIdx < snapshot->numTracks(); ++trackIdx)
 	{
-		editor->tracksChanged();
+		applyMutedTrackState((int)trackIdx, *snapshot);
 	}
+	snapshotExchange.publish(std::move(snapshot));
+	// the editor is updated on the message thread
+	tracksHaveChanged = true;
+	triggerAsyncUpdate();
 	updateFileWatcher(*compiledSheet);
 	startUdpSender(path);
 	return true;
 }
 
+void PluginProcessor::playCompiledSheet(CompiledSheetPtr sheet)
+{
+	PluginStateData::TrackRoutings trackRoutings;
+	{
+		LOCK(compileMutex);
+		trackRoutings = pluginStateData.trackRoutings;
+	}
+	auto snapshot = createPlaybackSnapshot(sheet, trackRoutings);
+	LOCK(compileMutex);
+	mutedTracks.clear();
+	compiledSheet = sheet;
+	trackNames = snapshot->trackNames;
+	snapshotExchange.publish(std::move(snapshot));
+}
+
 void PluginProcessor::startUdpSender(const juce::String &path)
 {
 	int port = readPreferencesData().funkfeuerPort;
 	auto pluginHost = juce::PluginHostType();
 	udpSender = std::make_unique<funk::UdpSender>(this, path.toStdString(), port);
 	udpSender->compiledSheet = compiledSheet;
+	udpSender->currentTimeInQuarters = &currentTimeInQuarters;
 	udpSender->hostDescription = pluginHost.getHostDescription();
 	udpSender->startThread();
 }
@@ -431,50 +485,6 @@ void PluginProcessor::stopUdpSender()
 	}
 }
 
-double PluginProcessor::getTempoInSecondsPerQuarterNote(const juce::MidiFile &midiFile)
-{
-	juce::MidiMessageSequence events;
-	midiFile.findAllTempoEvents(events);
-	if (events.getNumEvents() == 0)
-	{
-		return 0.5; // default is 120
-	}
-	// in werckmeister a piece has just one tempo event
-	return (*events.begin())->message.getTempoSecondsPerQuarterNote();
-}
-
-void PluginProcessor::findTrackName(size_t trackIndex, std::unordered_map<std::string, int>& trackAppearances)
-{
-	std::string trackName;
-	auto track = _midiFile.getTrack((int)trackIndex);
-	for (auto eventIt = track->begin(); eventIt != track->end(); ++eventIt)
-	{
-		const auto& midiMessage = (*eventIt)->message;
-		if (!midiMessage.isTrackNameEvent())
-		{
-			continue;
-		}
-		trackName = midiMessage.getTextFromTextMetaEvent().toStdString();
-		break;
-	}
-	if (trackName.empty())
-	{
-		trackName = std::string("Unnamed Track");
-	}
-	auto trackNameAppearanceIt = trackAppearances.find(trackName);
-	if (trackNameAppearanceIt == trackAppearances.end())
-	{
-		trackAppearances[trackName] = 1;
-	}
-	else
-	{
-		int trackCount = trackNameAppearanceIt->second + 1;
-		trackAppearances[trackName] = trackCount;
-		trackName = trackName + "(" + std::to_string(trackCount) + ")";
-	}
-	trackNames[trackIndex] = trackName;
-}
-
 void PluginProcessor::log(ILogger::LogFunction fLog)
 {
 	std::stringstream logStream;
@@ -491,19 +501,28 @@ void PluginProcessor::log(ILogger::LogFunction fLog)
 		<< std::setw(2) << now->tm_sec
 		<< "] ";
 	fLog(logStream);
-	
-	auto editor = dynamic_cast<PluginEditor*>(getActiveEditor());
-	if (editor == nullptr) 
 	{
-		logCache.push_back(logStream.str());
-		return;
+		std::lock_guard<Mutex> guard(logMutex);
+		pendingLogLines.push_back(logStream.str());
 	}
-	juce::String line(logStream.str());
-	editor->writeLine(line);
+	// log is called from the compile worker too, the editor is only touched on the message thread
+	triggerAsyncUpdate();
 }
 
 void PluginProcessor::onTrackFilterChanged(int trackIndex, bool filterValue)
 {
+	LOCK(compileMutex);
+	auto snapshot = snapshotExchange.latest();
+	if (snapshot != nullptr && (size_t)trackIndex < snapshot->numTracks())
+	{
+		snapshot->mutedTracks[(size_t)trackIndex].store(!filterValue, std::memory_order_relaxed);
+		snapshot->muteGeneration.fetch_add(1, std::memory_order_release);
+	}
+	if (trackIndex < 0 || (size_t)trackIndex >= trackNames.size())
+	{
+		// the editor's track list is outdated, a recompile is on its way
+		return;
+	}
 	if (!filterValue)
 	{
 		mutedTracks.insert(trackIndex);
@@ -514,17 +533,72 @@ void PluginProcessor::onTrackFilterChanged(int trackIndex, bool filterValue)
 	pluginStateData.mutedTracks.erase(trackNames.at((size_t)trackIndex));
 }
 
-bool PluginProcessor::isMuted(int trackIndex) const
+TrackRouting PluginProcessor::getTrackRouting(int trackIndex)
+{
+	LOCK(compileMutex);
+	if (trackIndex < 0 || (size_t)trackIndex >= trackNames.size())
+	{
+		return TrackRouting();
+	}
+	auto routingIt = pluginStateData.trackRoutings.find(trackNames.at((size_t)trackIndex));
+	if (routingIt == pluginStateData.trackRoutings.end())
+	{
+		return TrackRouting();
+	}
+	return routingIt->second;
+}
+
+void PluginProcessor::setTrackRouting(int trackIndex, const TrackRouting &routing)
+{
+	LOCK(compileMutex);
+	if (trackIndex < 0 || (size_t)trackIndex >= trackNames.size())
+	{
+		return;
+	}
+	pluginStateData.trackRoutings[trackNames.at((size_t)trackIndex)] = routing;
+	compileWorker.post(std::bind(&PluginProcessor::applyTrackRoutings, this));
+}
+
+void PluginProcessor::applyTrackRoutings()
+{
+	CompiledSheetPtr sheet;
+	PluginStateData::TrackRoutings trackRoutings;
+	{
+		LOCK(compileMutex);
+		sheet = compiledSheet;
+		trackRoutings = pluginStateData.trackRoutings;
+	}
+	if (!sheet)
+	{
+		return;
+	}
+	// routings are part of the snapshot, the engine swaps it like a recompiled sheet
+	auto snapshot = createPlaybackSnapshot(sheet, trackRoutings);
+	LOCK(compileMutex);
+	if (compiledSheet != sheet)
+	{
+		return;
+	}
+	for (auto mutedTrack : mutedTracks)
+	{
+		snapshot->mutedTracks[(size_t)mutedTrack].store(true, std::memory_order_relaxed);
+	}
+	snapshotExchange.publish(std::move(snapshot));
+}
+
+PluginProcessor::TrackStates PluginProcessor::getTrackStates() const
 {
-	return mutedTracks.find(trackIndex) != mutedTracks.end();
+	LOCK(compileMutex);
+	return { trackNames, mutedTracks };
 }
 
-void PluginProcessor::applyMutedTrackState(int trackIndex)
+void PluginProcessor::applyMutedTrackState(int trackIndex, PlaybackSnapshot &snapshot)
 {
 	auto trackName = trackNames.at((size_t)trackIndex);
 	bool isMuted = pluginStateData.mutedTracks.find(trackName) != pluginStateData.mutedTracks.end();
 	if (isMuted)
 	{
 		mutedTracks.insert(trackIndex);
+		snapshot.mutedTracks[(size_t)trackIndex].store(true, std::memory_order_relaxed);
 	}
 }
\ No newline at end of file
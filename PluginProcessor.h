@@ -8,17 +8,28 @@
 #include "PluginStateData.h"
 #include "ILogger.h"
 #include "FileWatcher.hpp"
+#include "CompileWorker.hpp"
 #include "Compiler.h"
 #include "UdpSender.hpp"
+#include "PlaybackSnapshot.h"
+#include "PlaybackEngine.h"
+#include "AudioThreadMonitor.h"
 #include <memory>
+#include <atomic>
+#include <mutex>
 
-class PluginProcessor : public juce::AudioProcessor, public ILogger
+class PluginProcessor : public juce::AudioProcessor, public juce::AsyncUpdater, public ILogger
 {
 public:
 	typedef int TrackIndex;
 	typedef std::unordered_set<TrackIndex> MutedTracks;
 	typedef std::list<std::string> LogCache;
 	typedef std::vector<std::string> TrackNames;
+	struct TrackStates
+	{
+		TrackNames trackNames;
+		MutedTracks mutedTracks;
+	};
 	PluginProcessor();
 	~PluginProcessor() override;
 	void prepareToPlay(double sampleRate, int samplesPerBlock) override;
@@ -40,48 +51,68 @@ public:
 	void changeProgramName(int index, const juce::String& newName) override;
 	void getStateInformation(juce::MemoryBlock& destData) override;
 	void setStateInformation(const void* data, int sizeInBytes) override;
-	bool compile(const juce::String& path);
+	/// compiles asynchronously on the compile worker, see CompileWorker
+	void requestCompile(const juce::String& path);
+	/// plays a sheet compiled elsewhere, without file watching and funkfeuer; used by the benchmark
+	void playCompiledSheet(CompiledSheetPtr sheet);
 	void reCompile();
 	void log(ILogger::LogFunction) override;
 	void info(ILogger::LogFunction f) override { log(f); }
 	void warn(ILogger::LogFunction f) override { log(f); }
 	void error(ILogger::LogFunction f) override { log(f); }
+	/// message thread only, log lines are delivered via handleAsyncUpdate
 	const LogCache& getLogCache() const { return logCache; }
 	void onTrackFilterChanged(int trackIndex, bool filterValue);
-	bool isMuted(int trackIndex) const;
-	TrackNames trackNames;
-	const MutedTracks& getMutedTracks() const { return mutedTracks; }
+	/// a copy made under the lock; track indices are only valid for this copy
+	TrackStates getTrackStates() const;
+	TrackRouting getTrackRouting(int trackIndex);
+	void setTrackRouting(int trackIndex, const TrackRouting &routing);
+	/// looks for the compiler on the compile worker thread
 	void initCompiler();
+	void handleAsyncUpdate() override;
+	AudioThreadMonitor& getAudioThreadMonitor() { return audioThreadMonitor; }
 private:
+	void mergeMidiOutput(juce::MidiBuffer& midiMessages);
+	void renderMidi(const juce::AudioBuffer<float>& buffer);
+	/// compile worker thread only
+	bool compile(const juce::String& path, const Compiler::CancelCheck& isCancelled);
+	void onCompileRequest(const CompileWorker::Request& request, const CompileWorker::CancelCheck& isCancelled);
+	void findCompiler();
+	/// compile worker thread only, rebuilds the playing snapshot with the current routings
+	void applyTrackRoutings();
 	void startUdpSender(const juce::String &path);
 	void stopUdpSender();
-	double currentSheetTempoInSecondsPerQuarterNote = 0;
-	bool compilerIsReady = false;
+	std::atomic<bool> compilerIsReady { false };
+	/// compile worker thread only, keys the compile cache
+	std::string compilerId;
 	MutedTracks mutedTracks;
-	struct NoteOffStackItem
-	{
-		const juce::MidiMessage noteOff;
-		int offsetInSamples = 0;
-	};
-	void findTrackName(size_t trackIndex, std::unordered_map<std::string, int> &trackAppearancesMap);
 	typedef std::mutex Mutex;
-	typedef std::list<NoteOffStackItem> NoteOffStack;
-	typedef juce::MidiMessageSequence::MidiEventHolder const* const* MidiEventIterator;
-	typedef std::vector<MidiEventIterator> IteratorTrackMap;
 	PluginStateData pluginStateData;
-	NoteOffStack noteOffStack;
-	Mutex processMutex;
+	/// serializes compile(), mute changes and snapshot publishing; never taken by the audio thread
+	mutable Mutex compileMutex;
+	TrackNames trackNames;
 	FileWatcher fileWatcher;
+	CompileWorker compileWorker;
 	std::unique_ptr<funk::UdpSender> udpSender;
-	void sendAllNoteOff(juce::MidiBuffer&);
 	void updateFileWatcher(const CompiledSheet&);
-	IteratorTrackMap _iteratorTrackMap;
-	juce::MidiFile _midiFile;
+	SnapshotExchange snapshotExchange;
+	/// audio thread only, used to detect a snapshot swap
+	PlaybackSnapshot* playingSnapshot = nullptr;
+	PlaybackEngine playbackEngine;
+	AudioThreadMonitor audioThreadMonitor;
+	enum { MidiOutputReserveInBytes = 4096 };
+	/// audio thread only: what the engine renders, merged into the host's buffer
+	juce::MidiBuffer midiOutput;
+	juce::MidiBuffer mergedMidiOutput;
+	std::atomic<double> currentTimeInQuarters { 0 };
 	bool _lastIsPlayingState = false;
-	void processNoteOffStack(juce::MidiBuffer& midiMessages);
-	void applyMutedTrackState(int trackIndex);
+	void applyMutedTrackState(int trackIndex, PlaybackSnapshot &snapshot);
+	/// message thread only
 	LogCache logCache;
+	/// written by any thread, drained into the editor or logCache by handleAsyncUpdate
+	LogCache pendingLogLines;
+	Mutex logMutex;
+	std::atomic<bool> tracksHaveChanged { false };
 	CompiledSheetPtr compiledSheet;
-	double getTempoInSecondsPerQuarterNote(const juce::MidiFile &midiFile);
 	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PluginProcessor)
 };
@@ -18,6 +18,13 @@ void writeStateData(const PluginStateData &stateData, juce::MemoryBlock &memoryB
     valueTree.setProperty("sheetPath", juce::var(stateData.sheetPath), nullptr);
     valueTree.setProperty("mutedTracks", juce::var(mutexTracksArray), nullptr);
     valueTree.setProperty("magicCode", juce::var(stateMagicCode), nullptr);
+    for (const auto& trackRouting : stateData.trackRoutings)
+    {
+        juce::ValueTree routingTree("trackRouting");
+        routingTree.setProperty("trackName", juce::var(trackRouting.first), nullptr);
+        routingTree.setProperty("channel", juce::var(trackRouting.second.channel), nullptr);
+        valueTree.appendChild(routingTree, nullptr);
+    }
     valueTree.writeToStream(os);
 }
 
@@ -40,5 +47,16 @@ PluginStateData readStateData(const void* data, int sizeInBytes)
             result.mutedTracks.insert(trackName.toStdString());
         }
     }
+    for (int i = 0; i < valueTree.getNumChildren(); ++i)
+    {
+        auto routingTree = valueTree.getChild(i);
+        if (!routingTree.hasType("trackRouting"))
+        {
+            continue;
+        }
+        TrackRouting trackRouting;
+        trackRouting.channel = routingTree.getProperty("channel", TrackRouting::KeepChannel);
+        result.trackRoutings[routingTree.getProperty("trackName").toString().toStdString()] = trackRouting;
+    }
     return result;
 }
\ No newline at end of file
@@ -2,14 +2,25 @@
 #include <string>
 #include <juce_core/juce_core.h>
 #include <unordered_map>
+#include <unordered_set>
+
+/// where the events of a track are sent to
+struct TrackRouting
+{
+    static const int KeepChannel = -1;
+    /// zero based midi channel for all channel messages of the track, or KeepChannel
+    int channel = KeepChannel;
+};
 
 struct PluginStateData 
 {
     typedef std::string TrackName;
     typedef std::unordered_set<TrackName> MutedTracks;
+    typedef std::unordered_map<TrackName, TrackRouting> TrackRoutings;
     bool isValid = false;
     std::string sheetPath;
     MutedTracks mutedTracks;
+    TrackRoutings trackRoutings;
 };
 
 void writeStateData(const PluginStateData&, juce::MemoryBlock&);
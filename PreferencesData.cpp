@@ -31,6 +31,7 @@ void writePreferencesData(const PreferencesData& data)
     juce::ValueTree valueTree("WerckmeisterVSTPreferencesData");
     valueTree.setProperty("binPath", juce::var(data.binPath), nullptr);
     valueTree.setProperty("funkfeuerPort", juce::var(port), nullptr);
+    valueTree.setProperty("compilerWorkerPath", juce::var(data.compilerWorkerPath), nullptr);
     configFile.replaceWithText(valueTree.toXmlString());
 }
 
@@ -44,6 +45,7 @@ PreferencesData readPreferencesData()
     }
     auto valueTree = juce::ValueTree::fromXml(configFile.loadFileAsString());
     result.binPath = valueTree.getProperty("binPath").toString().toStdString();
+    result.compilerWorkerPath = valueTree.getProperty("compilerWorkerPath").toString().toStdString();
     auto portProperty = valueTree.getProperty("funkfeuerPort");
     if (!portProperty.isVoid()) {
          result.funkfeuerPort = (int)valueTree.getProperty("funkfeuerPort");
@@ -12,6 +12,8 @@ namespace
 struct PreferencesData 
 {
     std::string binPath;
+    /// optional, a long-lived compiler worker, see WorkerCompilerBackend
+    std::string compilerWorkerPath;
     int funkfeuerPort = DefaultPort;
 };
 
@@ -0,0 +1,51 @@
+#include "Subprocess.hpp"
+#include "CancelWatchdog.hpp"
+
+const int Subprocess::READ_CHUNK_SIZE = 64 * 1024;
+
+namespace
+{
+	const Subprocess::CancelCheck neverCancelled = [](){ return false; };
+}
+
+Subprocess::Subprocess(const std::string &executable, const Arguments &arguments)
+{
+	WorkerProcess::CommandLine commandLine;
+	commandLine.push_back(executable);
+	commandLine.insert(commandLine.end(), arguments.begin(), arguments.end());
+	// stdout carries the compiler result, stderr is captured for the error report
+	started = process.start(commandLine, WorkerProcess::CaptureErrorOutput);
+}
+
+bool Subprocess::readOutput(const OutputHandler &onOutput, const CancelCheck &isCancelled)
+{
+	if (!started)
+	{
+		return false;
+	}
+	bool cancelled = false;
+	{
+		// the read blocks until output arrives, so the cancel check runs aside
+		CancelWatchdog watchdog(isCancelled, [this]() { process.kill(); });
+		buffer.resize((size_t)READ_CHUNK_SIZE);
+		size_t numBytesRead = 0;
+		while ((numBytesRead = process.read(buffer.data(), buffer.size())) > 0 && !watchdog.wasCancelled())
+		{
+			onOutput(buffer.data(), numBytesRead);
+		}
+		cancelled = watchdog.wasCancelled();
+	}
+	exitStatus = process.waitForExit();
+	return !cancelled;
+}
+
+std::string Subprocess::readAllOutput()
+{
+	std::string result;
+	readOutput([&result](const char *data, size_t numBytes) { result.append(data, numBytes); }, neverCancelled);
+	while (!result.empty() && (result.back() == '\n' || result.back() == '\r'))
+	{
+		result.pop_back();
+	}
+	return result;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <functional>
+#include <string>
+#include <vector>
+#include "WorkerProcess.hpp"
+
+/**
+ * Runs an executable without a shell, the arguments are passed as they are.
+ * The standard output is read in large chunks; a cancelled process is killed
+ * right away instead of being waited for. The standard error is kept apart,
+ * so it can be reported when the process fails.
+ */
+class Subprocess
+{
+public:
+	typedef std::vector<std::string> Arguments;
+	typedef std::function<bool()> CancelCheck;
+	/// called for every chunk read from the standard output
+	typedef std::function<void(const char *data, size_t numBytes)> OutputHandler;
+	Subprocess(const std::string &executable, const Arguments &arguments);
+	bool isStarted() const { return started; }
+	/// reads until the process closes its output and waits for it to end,
+	/// returns false if it was cancelled.
+	/// `isCancelled` is polled from a watchdog thread while the output is read
+	bool readOutput(const OutputHandler &onOutput, const CancelCheck &isCancelled);
+	/// the whole standard output, without the trailing line break
+	std::string readAllOutput();
+	/// valid after readOutput()
+	const WorkerProcess::ExitStatus& getExitStatus() const { return exitStatus; }
+	/// the standard error, complete after readOutput()
+	std::string getErrorOutput() const { return process.getErrorOutput(); }
+	static const int READ_CHUNK_SIZE;
+private:
+	WorkerProcess process;
+	WorkerProcess::ExitStatus exitStatus;
+	std::vector<char> buffer;
+	bool started = false;
+};
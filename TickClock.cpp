@@ -0,0 +1,32 @@
+#include "TickClock.h"
+#include <cmath>
+
+void TickClock::anchor(double tick, SamplePosition sample, double bpm, double sampleRate)
+{
+	anchorTick = tick;
+	anchorSample = sample;
+	_bpm = bpm;
+	_sampleRate = sampleRate;
+	samplesPerTick = (60.0 * sampleRate) / (bpm * ticksPerQuarterNote);
+}
+
+double TickClock::tickAt(SamplePosition sample) const
+{
+	return anchorTick + (double)(sample - anchorSample) / samplesPerTick;
+}
+
+TickClock::SamplePosition TickClock::sampleAt(TickPosition tick) const
+{
+	return anchorSample + (SamplePosition)std::llround(((double)tick - anchorTick) * samplesPerTick);
+}
+
+TickClock::TickPosition TickClock::firstTickAt(SamplePosition sample) const
+{
+	// start below and step up, so rounding noise in the host position can not skip an event
+	auto tick = (TickPosition)std::floor(tickAt(sample));
+	while (sampleAt(tick) < sample)
+	{
+		++tick;
+	}
+	return tick;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+/**
+ * Maps midi ticks of the sheet to absolute sample positions of the host,
+ * following the host tempo.
+ * The map is linear from an anchor on. It only needs a new anchor when the
+ * host tempo or sample rate changes or the playhead jumps; everything in
+ * between is a multiplication.
+ */
+class TickClock
+{
+public:
+	typedef juce::int64 TickPosition;
+	typedef juce::int64 SamplePosition;
+	void setTicksPerQuarterNote(int ticksPerQuarterNote_) { ticksPerQuarterNote = ticksPerQuarterNote_; }
+	/// maps `tick` to `sample`, later ticks follow with the given tempo
+	void anchor(double tick, SamplePosition sample, double bpm, double sampleRate);
+	bool hasTempo(double bpm, double sampleRate) const { return juce::exactlyEqual(bpm, _bpm) && juce::exactlyEqual(sampleRate, _sampleRate); }
+	double tickAt(SamplePosition sample) const;
+	SamplePosition sampleAt(TickPosition tick) const;
+	/// the first tick which maps to `sample` or later
+	TickPosition firstTickAt(SamplePosition sample) const;
+private:
+	int ticksPerQuarterNote = 960;
+	double anchorTick = 0;
+	SamplePosition anchorSample = 0;
+	double samplesPerTick = 1;
+	double _bpm = 0;
+	double _sampleRate = 0;
+};
@@ -58,9 +58,10 @@ namespace funk
 		juce::MemoryOutputStream ostream;
 		auto jsonObj = new juce::DynamicObject();
 		lastUpdateTimestamp = (unsigned long)time(NULL);
+		double sheetTime = currentTimeInQuarters ? currentTimeInQuarters->load(std::memory_order_relaxed) : 0;
 		jsonObj->setProperty("type", juce::var("werckmeister-vst-funk"));
 		jsonObj->setProperty("sheetPath", juce::var(_sheetPath));
-		jsonObj->setProperty("sheetTime", juce::var(currentTimeInQuarters));
+		jsonObj->setProperty("sheetTime", juce::var(sheetTime));
 		jsonObj->setProperty("instance", juce::var((juce::int64)this));
 		jsonObj->setProperty("lastUpdateTimestamp", juce::var((juce::int64)lastUpdateTimestamp));
 		jsonObj->setProperty("host", juce::var(hostDescription));
@@ -71,7 +72,7 @@ namespace funk
 			return ostream.toString();
 		}
 		const auto &timeline = sheet->eventInfos;
-		auto it = timeline.find(currentTimeInQuarters);
+		auto it = timeline.find(sheetTime);
 		if (it == timeline.end())
 		{
 			juce::JSON::writeToStream(ostream, jsonObj, true);
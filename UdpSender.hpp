@@ -2,6 +2,7 @@
 
 #include <tuple>
 #include <memory>
+#include <atomic>
 #include <vector>
 #include <boost/asio.hpp>
 #include <boost/core/noncopyable.hpp>
@@ -45,7 +46,8 @@ namespace funk
 	public:
 		std::weak_ptr<CompiledSheet> compiledSheet;
 		std::string hostDescription;
-		double currentTimeInQuarters = 0;
+		/// owned by the plugin processor, written by the audio thread
+		const std::atomic<double>* currentTimeInQuarters = nullptr;
 		UdpSender(ILogger *logger, const std::string &sheetPathName, int port);
 		virtual ~UdpSender() = default;
 		virtual void run() override;
@@ -0,0 +1,468 @@
+#include "WorkerProcess.hpp"
+
+#include <algorithm>
+
+#if JUCE_WINDOWS
+#include <windows.h>
+#else
+#include <cerrno>
+#include <csignal>
+#include <ctime>
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+extern char **environ;
+#endif
+
+const size_t WorkerProcess::MaxErrorOutputSize = 64 * 1024;
+
+WorkerProcess::~WorkerProcess()
+{
+	kill();
+	close();
+}
+
+bool WorkerProcess::readExactly(void *data, size_t numBytes)
+{
+	auto bytes = static_cast<char*>(data);
+	while (numBytes > 0)
+	{
+		auto numBytesRead = read(bytes, numBytes);
+		if (numBytesRead == 0)
+		{
+			return false;
+		}
+		bytes += numBytesRead;
+		numBytes -= numBytesRead;
+	}
+	return true;
+}
+
+std::string WorkerProcess::getErrorOutput() const
+{
+	std::lock_guard<Mutex> guard(errorOutputMutex);
+	return errorOutput;
+}
+
+void WorkerProcess::appendErrorOutput(const char *data, size_t numBytes)
+{
+	std::lock_guard<Mutex> guard(errorOutputMutex);
+	auto room = MaxErrorOutputSize - errorOutput.size();
+	errorOutput.append(data, (std::min)(numBytes, room));
+}
+
+void WorkerProcess::joinErrorReader()
+{
+	if (errorReader.joinable())
+	{
+		errorReader.join();
+	}
+}
+
+#if JUCE_WINDOWS
+
+namespace
+{
+	juce::String quoteArgument(const std::string &argument)
+	{
+		auto result = juce::String::fromUTF8(argument.c_str());
+		if (result.isNotEmpty() && !result.containsAnyOf(" \t\""))
+		{
+			return result;
+		}
+		return "\"" + result.replace("\"", "\\\"") + "\"";
+	}
+}
+
+bool WorkerProcess::start(const CommandLine &commandLine, int flags)
+{
+	juce::String commandLineString;
+	for (const auto &argument : commandLine)
+	{
+		commandLineString << quoteArgument(argument) << " ";
+	}
+	SECURITY_ATTRIBUTES securityAttributes = { sizeof(SECURITY_ATTRIBUTES), nullptr, TRUE };
+	HANDLE childStdIn = nullptr, childStdOut = nullptr, parentWrite = nullptr, parentRead = nullptr;
+	if (!CreatePipe(&childStdIn, &parentWrite, &securityAttributes, 0))
+	{
+		return false;
+	}
+	if (!CreatePipe(&parentRead, &childStdOut, &securityAttributes, 0))
+	{
+		CloseHandle(childStdIn);
+		CloseHandle(parentWrite);
+		return false;
+	}
+	HANDLE childStdErr = nullptr, errorRead = nullptr;
+	if ((flags & CaptureErrorOutput) != 0 && !CreatePipe(&errorRead, &childStdErr, &securityAttributes, 0))
+	{
+		for (auto handle : { childStdIn, parentWrite, parentRead, childStdOut })
+		{
+			CloseHandle(handle);
+		}
+		return false;
+	}
+	// only the child ends are inherited
+	SetHandleInformation(parentWrite, HANDLE_FLAG_INHERIT, 0);
+	SetHandleInformation(parentRead, HANDLE_FLAG_INHERIT, 0);
+	if (errorRead != nullptr)
+	{
+		SetHandleInformation(errorRead, HANDLE_FLAG_INHERIT, 0);
+	}
+	STARTUPINFOW startupInfo = {};
+	startupInfo.cb = sizeof(startupInfo);
+	startupInfo.dwFlags = STARTF_USESTDHANDLES;
+	startupInfo.hStdInput = childStdIn;
+	startupInfo.hStdOutput = childStdOut;
+	startupInfo.hStdError = childStdErr != nullptr ? childStdErr : GetStdHandle(STD_ERROR_HANDLE);
+	PROCESS_INFORMATION processInfo = {};
+	auto started = CreateProcessW(nullptr, const_cast<LPWSTR>(commandLineString.trimEnd().toWideCharPointer()),
+		nullptr, nullptr, TRUE, CREATE_NO_WINDOW, nullptr, nullptr, &startupInfo, &processInfo) != FALSE;
+	CloseHandle(childStdIn);
+	CloseHandle(childStdOut);
+	if (childStdErr != nullptr)
+	{
+		CloseHandle(childStdErr);
+	}
+	if (!started)
+	{
+		CloseHandle(parentWrite);
+		CloseHandle(parentRead);
+		if (errorRead != nullptr)
+		{
+			CloseHandle(errorRead);
+		}
+		return false;
+	}
+	if (errorRead != nullptr)
+	{
+		// drained aside, a full stderr pipe would block the worker
+		errorReader = std::thread([this, errorRead]()
+		{
+			char chunk[4096];
+			DWORD numBytesRead = 0;
+			while (ReadFile(errorRead, chunk, sizeof(chunk), &numBytesRead, nullptr) && numBytesRead > 0)
+			{
+				appendErrorOutput(chunk, numBytesRead);
+			}
+			CloseHandle(errorRead);
+		});
+	}
+	CloseHandle(processInfo.hThread);
+	processHandle = processInfo.hProcess;
+	writeHandle = parentWrite;
+	readHandle = parentRead;
+	return true;
+}
+
+bool WorkerProcess::isRunning()
+{
+	return processHandle != nullptr && WaitForSingleObject(processHandle, 0) == WAIT_TIMEOUT;
+}
+
+bool WorkerProcess::write(const void *data, size_t numBytes)
+{
+	auto bytes = static_cast<const char*>(data);
+	while (numBytes > 0)
+	{
+		DWORD numBytesWritten = 0;
+		if (writeHandle == nullptr || !WriteFile(writeHandle, bytes, (DWORD)numBytes, &numBytesWritten, nullptr))
+		{
+			return false;
+		}
+		bytes += numBytesWritten;
+		numBytes -= numBytesWritten;
+	}
+	return true;
+}
+
+size_t WorkerProcess::read(void *data, size_t maxBytes)
+{
+	DWORD numBytesRead = 0;
+	if (readHandle == nullptr || !ReadFile(readHandle, data, (DWORD)(std::min<size_t>)(maxBytes, MAXDWORD), &numBytesRead, nullptr))
+	{
+		return 0;
+	}
+	return numBytesRead;
+}
+
+void WorkerProcess::kill()
+{
+	if (processHandle != nullptr)
+	{
+		TerminateProcess(processHandle, 1);
+	}
+}
+
+WorkerProcess::ExitStatus WorkerProcess::waitForExit()
+{
+	if (writeHandle != nullptr)
+	{
+		CloseHandle(writeHandle);
+		writeHandle = nullptr;
+	}
+	if (processHandle != nullptr)
+	{
+		WaitForSingleObject(processHandle, INFINITE);
+		DWORD exitCode = 0;
+		GetExitCodeProcess(processHandle, &exitCode);
+		// an unhandled exception ends the process with its NTSTATUS error code
+		exitStatus.hasCrashed = (exitCode & 0xC0000000) == 0xC0000000;
+		exitStatus.exitCode = (int)exitCode;
+		CloseHandle(processHandle);
+		processHandle = nullptr;
+	}
+	joinErrorReader();
+	return exitStatus;
+}
+
+void WorkerProcess::close()
+{
+	if (readHandle != nullptr)
+	{
+		CloseHandle(readHandle);
+		readHandle = nullptr;
+	}
+	waitForExit();
+}
+
+#else
+
+namespace
+{
+	void closeFd(int &fd)
+	{
+		if (fd >= 0)
+		{
+			::close(fd);
+			fd = -1;
+		}
+	}
+
+	/// all ends are close-on-exec: the spawn's dup2 clears the flag on the child's stdin/stdout,
+	/// so only those survive and no other process inherits a pipe end
+	bool createPipe(int fds[2])
+	{
+#if JUCE_LINUX
+		return ::pipe2(fds, O_CLOEXEC) == 0;
+#else
+		// no pipe2 on macOS, the flag is set right after creation
+		if (::pipe(fds) != 0)
+		{
+			return false;
+		}
+		for (int i = 0; i < 2; ++i)
+		{
+			::fcntl(fds[i], F_SETFD, ::fcntl(fds[i], F_GETFD) | FD_CLOEXEC);
+		}
+		return true;
+#endif
+	}
+
+	void setExitStatus(WorkerProcess::ExitStatus &exitStatus, int status)
+	{
+		exitStatus.hasCrashed = WIFSIGNALED(status);
+		exitStatus.exitCode = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+	}
+
+	/// writing to a worker which died raises SIGPIPE, that must not take the host down.
+	/// The signal is blocked for this thread only and a pending one is swallowed
+	class SigPipeGuard
+	{
+	public:
+		SigPipeGuard()
+		{
+			sigemptyset(&sigPipe);
+			sigaddset(&sigPipe, SIGPIPE);
+			pthread_sigmask(SIG_BLOCK, &sigPipe, &previousMask);
+		}
+		~SigPipeGuard()
+		{
+#if JUCE_LINUX
+			timespec noWait = { 0, 0 };
+			while (sigtimedwait(&sigPipe, nullptr, &noWait) > 0) {}
+#else
+			sigset_t pending;
+			sigpending(&pending);
+			if (sigismember(&pending, SIGPIPE))
+			{
+				int signal = 0;
+				sigwait(&sigPipe, &signal);
+			}
+#endif
+			pthread_sigmask(SIG_SETMASK, &previousMask, nullptr);
+		}
+	private:
+		sigset_t sigPipe;
+		sigset_t previousMask;
+	};
+}
+
+bool WorkerProcess::start(const CommandLine &commandLine, int flags)
+{
+	if (commandLine.empty())
+	{
+		return false;
+	}
+	int toChild[2];
+	int fromChild[2];
+	if (!createPipe(toChild))
+	{
+		return false;
+	}
+	if (!createPipe(fromChild))
+	{
+		::close(toChild[0]);
+		::close(toChild[1]);
+		return false;
+	}
+	int fromChildErr[2] = { -1, -1 };
+	bool captureErrorOutput = (flags & CaptureErrorOutput) != 0;
+	if (captureErrorOutput && !createPipe(fromChildErr))
+	{
+		for (auto fd : { toChild[0], toChild[1], fromChild[0], fromChild[1] })
+		{
+			::close(fd);
+		}
+		return false;
+	}
+	posix_spawn_file_actions_t fileActions;
+	posix_spawn_file_actions_init(&fileActions);
+	posix_spawn_file_actions_adddup2(&fileActions, toChild[0], STDIN_FILENO);
+	posix_spawn_file_actions_adddup2(&fileActions, fromChild[1], STDOUT_FILENO);
+	if (captureErrorOutput)
+	{
+		posix_spawn_file_actions_adddup2(&fileActions, fromChildErr[1], STDERR_FILENO);
+	}
+	std::vector<char*> argv;
+	for (const auto &argument : commandLine)
+	{
+		argv.push_back(const_cast<char*>(argument.c_str()));
+	}
+	argv.push_back(nullptr);
+	pid_t childPid = 0;
+	auto result = posix_spawnp(&childPid, argv[0], &fileActions, nullptr, argv.data(), environ);
+	posix_spawn_file_actions_destroy(&fileActions);
+	::close(toChild[0]);
+	::close(fromChild[1]);
+	closeFd(fromChildErr[1]);
+	if (result != 0)
+	{
+		::close(toChild[1]);
+		::close(fromChild[0]);
+		closeFd(fromChildErr[0]);
+		return false;
+	}
+	if (captureErrorOutput)
+	{
+		// drained aside, a full stderr pipe would block the worker
+		errorReader = std::thread([this, errorFd = fromChildErr[0]]() mutable
+		{
+			char chunk[4096];
+			ssize_t numBytesRead = 0;
+			while ((numBytesRead = ::read(errorFd, chunk, sizeof(chunk))) > 0 || (numBytesRead < 0 && errno == EINTR))
+			{
+				if (numBytesRead > 0)
+				{
+					appendErrorOutput(chunk, (size_t)numBytesRead);
+				}
+			}
+			closeFd(errorFd);
+		});
+	}
+	pid = childPid;
+	writeFd = toChild[1];
+	readFd = fromChild[0];
+	return true;
+}
+
+bool WorkerProcess::isRunning()
+{
+	if (pid == 0)
+	{
+		return false;
+	}
+	int status = 0;
+	auto result = ::waitpid(pid, &status, WNOHANG);
+	if (result == 0)
+	{
+		return true;
+	}
+	if (result == pid)
+	{
+		setExitStatus(exitStatus, status);
+	}
+	// reaped, the pid may be reused by now and must not be killed or waited for again
+	pid = 0;
+	return false;
+}
+
+bool WorkerProcess::write(const void *data, size_t numBytes)
+{
+	SigPipeGuard sigPipeGuard;
+	auto bytes = static_cast<const char*>(data);
+	while (numBytes > 0)
+	{
+		auto numBytesWritten = ::write(writeFd, bytes, numBytes);
+		if (numBytesWritten < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		if (numBytesWritten <= 0)
+		{
+			return false;
+		}
+		bytes += numBytesWritten;
+		numBytes -= (size_t)numBytesWritten;
+	}
+	return true;
+}
+
+size_t WorkerProcess::read(void *data, size_t maxBytes)
+{
+	while (true)
+	{
+		auto numBytesRead = ::read(readFd, data, maxBytes);
+		if (numBytesRead < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		return numBytesRead > 0 ? (size_t)numBytesRead : 0;
+	}
+}
+
+void WorkerProcess::kill()
+{
+	auto workerPid = pid.load();
+	if (workerPid != 0)
+	{
+		::kill(workerPid, SIGKILL);
+	}
+}
+
+WorkerProcess::ExitStatus WorkerProcess::waitForExit()
+{
+	closeFd(writeFd);
+	auto workerPid = pid.exchange(0);
+	if (workerPid != 0)
+	{
+		int status = 0;
+		pid_t result = 0;
+		while ((result = ::waitpid(workerPid, &status, 0)) < 0 && errno == EINTR) {}
+		if (result == workerPid)
+		{
+			setExitStatus(exitStatus, status);
+		}
+	}
+	joinErrorReader();
+	return exitStatus;
+}
+
+void WorkerProcess::close()
+{
+	closeFd(readFd);
+	waitForExit();
+}
+
+#endif
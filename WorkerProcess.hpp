@@ -0,0 +1,74 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * A child process with pipes to its stdin and stdout, for long-lived
+ * workers which take requests and answer them one after the other, and
+ * for Subprocess. juce::ChildProcess can neither write nor keep stderr
+ * apart from stdout, so this starts the process itself. There is no shell;
+ * stderr stays with the host unless it is captured.
+ */
+class WorkerProcess
+{
+public:
+	typedef std::vector<std::string> CommandLine;
+	enum StartFlags
+	{
+		KeepErrorOutput = 0,
+		/// stderr is read on a thread of its own, see getErrorOutput()
+		CaptureErrorOutput = 1
+	};
+	struct ExitStatus
+	{
+		/// ended by a signal or an unhandled exception rather than by exiting
+		bool hasCrashed = false;
+		int exitCode = 0;
+	};
+	WorkerProcess() = default;
+	WorkerProcess(const WorkerProcess&) = delete;
+	WorkerProcess& operator=(const WorkerProcess&) = delete;
+	/// kills a still running worker
+	~WorkerProcess();
+	bool start(const CommandLine &commandLine, int flags = KeepErrorOutput);
+	/// reaps the worker once it exited
+	bool isRunning();
+	/// false if the worker is gone
+	bool write(const void *data, size_t numBytes);
+	/// blocks until some bytes arrived, returns 0 once the worker closed its output
+	size_t read(void *data, size_t maxBytes);
+	/// blocks until `numBytes` arrived, false if the worker closed its output before
+	bool readExactly(void *data, size_t numBytes);
+	/// any thread, makes a blocking read return
+	void kill();
+	/// closes the worker's stdin and blocks until it ended
+	ExitStatus waitForExit();
+	/// the captured stderr, complete once waitForExit() returned
+	std::string getErrorOutput() const;
+	/// stderr beyond this is dropped
+	static const size_t MaxErrorOutputSize;
+private:
+	typedef std::mutex Mutex;
+#if JUCE_WINDOWS
+	void *processHandle = nullptr;
+	void *writeHandle = nullptr;
+	void *readHandle = nullptr;
+#else
+	/// read by kill() from any thread
+	std::atomic<int> pid { 0 };
+	int writeFd = -1;
+	int readFd = -1;
+#endif
+	ExitStatus exitStatus;
+	std::thread errorReader;
+	mutable Mutex errorOutputMutex;
+	std::string errorOutput;
+	void appendErrorOutput(const char *data, size_t numBytes);
+	void joinErrorReader();
+	void close();
+};
@@ -0,0 +1,90 @@
+#include "Base64.h"
+#include <juce_core/juce_core.h>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+/**
+ * Compares the decoding of the compiler's base64 midi data:
+ * the former juce::Base64 path with its copy into the sheet,
+ * the portable decoder and the simd decoder.
+ * Usage: WerckmeisterBase64Benchmark [--quick]
+ */
+namespace
+{
+	typedef std::vector<unsigned char> Bytes;
+	typedef std::function<void(const juce::String&, Bytes&)> Decoder;
+
+	void decodeJuce(const juce::String &base64, Bytes &bytes)
+	{
+		double estimatedByteSize = (base64.length() * (3.0 / 4.0) + 10);
+		juce::MemoryOutputStream byteStream((size_t)estimatedByteSize);
+		juce::Base64::convertFromBase64(byteStream, base64);
+		bytes.resize(byteStream.getDataSize());
+		::memcpy(bytes.data(), byteStream.getData(), bytes.size());
+	}
+
+	void decodeScalar(const juce::String &base64, Bytes &bytes)
+	{
+		decodeBase64Scalar(base64.toRawUTF8(), base64.getNumBytesAsUTF8(), bytes);
+	}
+
+	void decodeSimd(const juce::String &base64, Bytes &bytes)
+	{
+		decodeBase64(base64.toRawUTF8(), base64.getNumBytesAsUTF8(), bytes);
+	}
+
+	/// megabytes of decoded data per second, a fresh vector per run like a compile gets
+	double run(const Decoder &decode, const juce::String &base64, const Bytes &expected, int numRuns)
+	{
+		double seconds = 0;
+		for (int i = 0; i < numRuns; ++i)
+		{
+			Bytes bytes;
+			auto start = juce::Time::getHighResolutionTicks();
+			decode(base64, bytes);
+			auto end = juce::Time::getHighResolutionTicks();
+			seconds += juce::Time::highResolutionTicksToSeconds(end - start);
+			if (bytes != expected)
+			{
+				std::cerr << "decoded data differs" << std::endl;
+				std::exit(1);
+			}
+		}
+		return (double)expected.size() * numRuns / seconds / (1024 * 1024);
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	bool quick = argc > 1 && std::strcmp(argv[1], "--quick") == 0;
+	std::vector<size_t> sizes = { 64 * 1024, 1024 * 1024, 16 * 1024 * 1024 };
+	if (quick)
+	{
+		sizes = { 1024 * 1024 };
+	}
+	std::mt19937 random(1);
+	std::cout << std::setw(12) << "bytes" << std::setw(14) << "juce MB/s" << std::setw(14) << "scalar MB/s" << std::setw(14) << "simd MB/s" << std::endl;
+	for (auto size : sizes)
+	{
+		Bytes data(size);
+		for (auto &byte : data)
+		{
+			byte = (unsigned char)random();
+		}
+		auto base64 = juce::Base64::toBase64(data.data(), data.size());
+		auto numRuns = std::max(3, (int)((256 * 1024 * 1024) / size));
+		if (quick)
+		{
+			numRuns = 3;
+		}
+		std::cout << std::setw(12) << size
+			<< std::setw(14) << std::fixed << std::setprecision(1) << run(decodeJuce, base64, data, numRuns)
+			<< std::setw(14) << run(decodeScalar, base64, data, numRuns)
+			<< std::setw(14) << run(decodeSimd, base64, data, numRuns) << std::endl;
+	}
+	return 0;
+}
@@ -0,0 +1,185 @@
+#include "PluginProcessor.h"
+#include "SyntheticSheet.h"
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+/**
+ * Runs PluginProcessor::processBlock() against generated sheets and a
+ * synthetic play head and prints the cost per block.
+ * Usage: WerckmeisterBenchmark [--quick] [--blocks n]
+ */
+namespace
+{
+	const double SampleRate = 48000;
+	const double Bpm = 120;
+	const double LoopStartInQuarters = 16;
+	const double LoopEndInQuarters = 20;
+
+	enum class Scenario { Play, Seek, Loop };
+
+	const char* toString(Scenario scenario)
+	{
+		switch (scenario)
+		{
+		case Scenario::Play: return "play";
+		case Scenario::Seek: return "seek";
+		case Scenario::Loop: return "loop";
+		}
+		return "";
+	}
+
+	class SyntheticPlayHead : public juce::AudioPlayHead
+	{
+	public:
+		CurrentPositionInfo info;
+#if JUCE_MAJOR_VERSION >= 7
+		juce::Optional<PositionInfo> getPosition() const override
+		{
+			PositionInfo result;
+			result.setTimeInSamples(info.timeInSamples);
+			result.setTimeInSeconds(info.timeInSeconds);
+			result.setPpqPosition(info.ppqPosition);
+			result.setBpm(info.bpm);
+			result.setIsPlaying(info.isPlaying);
+			result.setIsLooping(info.isLooping);
+			result.setLoopPoints(LoopPoints { info.ppqLoopStart, info.ppqLoopEnd });
+			return result;
+		}
+#else
+		bool getCurrentPosition(CurrentPositionInfo& result) override
+		{
+			result = info;
+			return true;
+		}
+#endif
+	};
+
+	struct Result
+	{
+		double meanNanosPerBlock = 0;
+		double p99NanosPerBlock = 0;
+		double nanosPerEvent = 0;
+	};
+
+	Result run(PluginProcessor &processor, SyntheticPlayHead &playHead, Scenario scenario, int blockSize, int numBlocks, double lengthInQuarters)
+	{
+		std::mt19937 random(1);
+		std::uniform_real_distribution<double> anyPosition(0, lengthInQuarters);
+		auto samplesPerQuarter = SampleRate * 60.0 / Bpm;
+		juce::AudioBuffer<float> buffer(2, blockSize);
+		juce::MidiBuffer midiMessages;
+		std::vector<double> durations;
+		durations.reserve((size_t)numBlocks);
+		auto &info = playHead.info;
+		info = {};
+		info.bpm = Bpm;
+		info.isPlaying = true;
+		info.isLooping = scenario == Scenario::Loop;
+		info.ppqLoopStart = LoopStartInQuarters;
+		info.ppqLoopEnd = LoopEndInQuarters;
+		double ppq = scenario == Scenario::Loop ? LoopStartInQuarters : 0;
+		juce::int64 sample = 0;
+		juce::int64 numEvents = 0;
+		for (int blockIndex = 0; blockIndex < numBlocks; ++blockIndex)
+		{
+			info.timeInSamples = sample;
+			info.timeInSeconds = sample / SampleRate;
+			info.ppqPosition = ppq;
+			midiMessages.clear();
+			auto start = juce::Time::getHighResolutionTicks();
+			processor.processBlock(buffer, midiMessages);
+			auto end = juce::Time::getHighResolutionTicks();
+			durations.push_back(juce::Time::highResolutionTicksToSeconds(end - start) * 1e9);
+			numEvents += midiMessages.getNumEvents();
+			sample += blockSize;
+			ppq += blockSize / samplesPerQuarter;
+			switch (scenario)
+			{
+			case Scenario::Play:
+				ppq = ppq >= lengthInQuarters ? 0 : ppq;
+				break;
+			case Scenario::Seek:
+				ppq = anyPosition(random);
+				break;
+			case Scenario::Loop:
+				ppq = ppq >= LoopEndInQuarters ? LoopStartInQuarters + (ppq - LoopEndInQuarters) : ppq;
+				break;
+			}
+		}
+		// stop, so the next run starts from a clean transport
+		info.isPlaying = false;
+		midiMessages.clear();
+		processor.processBlock(buffer, midiMessages);
+		Result result;
+		double total = 0;
+		for (auto duration : durations)
+		{
+			total += duration;
+		}
+		result.meanNanosPerBlock = total / durations.size();
+		std::sort(durations.begin(), durations.end());
+		result.p99NanosPerBlock = durations[(durations.size() * 99) / 100];
+		result.nanosPerEvent = numEvents > 0 ? total / numEvents : 0;
+		return result;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	bool quick = false;
+	int numBlocks = 2000;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (std::strcmp(argv[i], "--quick") == 0)
+		{
+			quick = true;
+		}
+		else if (std::strcmp(argv[i], "--blocks") == 0 && i + 1 < argc)
+		{
+			numBlocks = std::max(1, std::atoi(argv[++i]));
+		}
+	}
+	juce::ScopedJuceInitialiser_GUI juceInitialiser;
+	std::vector<int> noteCounts = { 1000, 10000, 100000, 1000000 };
+	std::vector<int> trackCounts = { 1, 8, 32, 128 };
+	std::vector<int> blockSizes = { 64, 512, 4096 };
+	if (quick)
+	{
+		noteCounts = { 1000, 100000 };
+		trackCounts = { 1, 32 };
+		blockSizes = { 512 };
+	}
+	PluginProcessor processor;
+	SyntheticPlayHead playHead;
+	processor.setPlayHead(&playHead);
+	processor.prepareToPlay(SampleRate, blockSizes.back());
+	std::cout << std::setw(8) << "notes" << std::setw(8) << "tracks" << std::setw(8) << "block" << std::setw(8) << "mode"
+		<< std::setw(16) << "ns/block" << std::setw(16) << "p99 ns/block" << std::setw(12) << "ns/event" << std::endl;
+	for (auto numNotes : noteCounts)
+	{
+		for (auto numTracks : trackCounts)
+		{
+			SyntheticSheetOptions options;
+			options.numNotes = numNotes;
+			options.numTracks = numTracks;
+			processor.playCompiledSheet(createSyntheticSheet(options));
+			for (auto blockSize : blockSizes)
+			{
+				for (auto scenario : { Scenario::Play, Scenario::Seek, Scenario::Loop })
+				{
+					auto result = run(processor, playHead, scenario, blockSize, numBlocks, options.lengthInQuarters);
+					std::cout << std::setw(8) << numNotes << std::setw(8) << numTracks << std::setw(8) << blockSize << std::setw(8) << toString(scenario)
+						<< std::fixed << std::setprecision(0)
+						<< std::setw(16) << result.meanNanosPerBlock << std::setw(16) << result.p99NanosPerBlock
+						<< std::setprecision(1) << std::setw(12) << result.nanosPerEvent << std::endl;
+				}
+			}
+		}
+	}
+	processor.setPlayHead(nullptr);
+	return 0;
+}
@@ -0,0 +1,62 @@
+#include "SyntheticSheet.h"
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <random>
+#include <string>
+
+namespace
+{
+	/// a controller change every n notes
+	const int NotesPerControllerChange = 16;
+
+	juce::MidiMessage at(juce::MidiMessage message, double tick)
+	{
+		message.setTimeStamp(tick);
+		return message;
+	}
+}
+
+CompiledSheetPtr createSyntheticSheet(const SyntheticSheetOptions &options)
+{
+	std::mt19937 random(options.seed);
+	auto lengthInTicks = options.lengthInQuarters * options.ticksPerQuarterNote;
+	std::uniform_real_distribution<double> position(0, lengthInTicks);
+	std::uniform_real_distribution<double> duration(options.ticksPerQuarterNote / 8.0, options.ticksPerQuarterNote * 4.0);
+	std::uniform_int_distribution<int> key(24, 108);
+	std::uniform_int_distribution<int> velocity(1, 127);
+	std::uniform_int_distribution<int> controllerValue(0, 127);
+	juce::MidiFile midiFile;
+	midiFile.setTicksPerQuarterNote(options.ticksPerQuarterNote);
+	juce::MidiMessageSequence masterTrack;
+	masterTrack.addEvent(at(juce::MidiMessage::tempoMetaEvent(500000), 0));
+	masterTrack.addEvent(at(juce::MidiMessage::textMetaEvent(3, "master track"), 0));
+	midiFile.addTrack(masterTrack);
+	for (int trackIndex = 0; trackIndex < options.numTracks; ++trackIndex)
+	{
+		auto channel = trackIndex % 16 + 1;
+		juce::MidiMessageSequence track;
+		track.addEvent(at(juce::MidiMessage::textMetaEvent(3, "track " + std::to_string(trackIndex)), 0));
+		track.addEvent(at(juce::MidiMessage::programChange(channel, trackIndex % 128), 0));
+		auto numNotes = options.numNotes / options.numTracks + (trackIndex < options.numNotes % options.numTracks ? 1 : 0);
+		for (int noteIndex = 0; noteIndex < numNotes; ++noteIndex)
+		{
+			auto begin = position(random);
+			auto end = std::min(begin + duration(random), lengthInTicks);
+			auto noteNumber = key(random);
+			track.addEvent(at(juce::MidiMessage::noteOn(channel, noteNumber, (juce::uint8)velocity(random)), begin));
+			track.addEvent(at(juce::MidiMessage::noteOff(channel, noteNumber, (juce::uint8)0), end));
+			if (noteIndex % NotesPerControllerChange == 0)
+			{
+				track.addEvent(at(juce::MidiMessage::controllerEvent(channel, 7, controllerValue(random)), begin));
+			}
+		}
+		track.sort();
+		track.updateMatchedPairs();
+		midiFile.addTrack(track);
+	}
+	juce::MemoryOutputStream stream;
+	midiFile.writeTo(stream);
+	auto sheet = std::make_shared<CompiledSheet>();
+	auto data = static_cast<const unsigned char*>(stream.getData());
+	sheet->midiData.assign(data, data + stream.getDataSize());
+	return sheet;
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "CompiledSheet.h"
+
+/// how a generated sheet looks like
+struct SyntheticSheetOptions
+{
+	int numTracks = 1;
+	/// note ons over all tracks, controller and program changes come on top
+	int numNotes = 1000;
+	double lengthInQuarters = 1200;
+	int ticksPerQuarterNote = 960;
+	unsigned seed = 1;
+};
+
+/// a compiled sheet with random notes, controllers and program changes, no sources
+CompiledSheetPtr createSyntheticSheet(const SyntheticSheetOptions &options);
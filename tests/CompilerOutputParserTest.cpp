@@ -0,0 +1,268 @@
+#include "CompilerOutputParser.h"
+#include "Base64.h"
+#include <juce_core/juce_core.h>
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+	/// in seconds or quarters, juce::JSON and the parser may round the last digit differently
+	const double MaxTimeError = 1e-9;
+	const char * UnexpectedResponse = "unexpected compiler response";
+
+	struct Outcome
+	{
+		bool failed = false;
+		/// only set for errors the compiler reported
+		bool isCompilerError = false;
+		std::string message;
+		CompiledSheet sheet;
+	};
+
+	const juce::var & get(const juce::var &json, const char *key, bool expected = true)
+	{
+		auto &result = json[key];
+		if (expected && result.isVoid())
+		{
+			throw std::runtime_error(UnexpectedResponse);
+		}
+		return result;
+	}
+
+	/// the compile before CompilerOutputParser: the whole document into a juce::var tree first
+	Outcome parseWithJuceJson(const std::string &document)
+	{
+		Outcome outcome;
+		try
+		{
+			auto json = juce::JSON::parse(juce::String::fromUTF8(document.data(), (int)document.size()));
+			const auto &errorMessage = get(json, "errorMessage", false);
+			if (!errorMessage.isVoid())
+			{
+				const auto &sourceFile = get(json, "sourceFile", false);
+				const auto &position = get(json, "positionBegin", false);
+				std::stringstream ss;
+				if (!sourceFile.isVoid())
+				{
+					ss << "in file \"" << sourceFile.toString() << "\"";
+				}
+				if (!position.isVoid())
+				{
+					ss << ": position " << position.toString();
+				}
+				ss << "\n" << errorMessage.toString();
+				outcome.failed = true;
+				outcome.isCompilerError = true;
+				outcome.message = ss.str();
+				return outcome;
+			}
+			auto &sheet = outcome.sheet;
+			const auto &midiInfo = get(json, "midi");
+			const auto &base64MidiData = get(midiInfo, "midiData", false);
+			if (!base64MidiData.isVoid() && base64MidiData.toString().isNotEmpty())
+			{
+				auto text = base64MidiData.toString();
+				if (!decodeBase64(text.toRawUTF8(), text.getNumBytesAsUTF8(), sheet.midiData))
+				{
+					throw std::runtime_error("invalid midi data");
+				}
+			}
+			const auto &sources = get(midiInfo, "sources");
+			for (int i = 0; i < sources.size(); ++i)
+			{
+				const auto &sourceId = get(sources[i], "sourceId");
+				const auto &path = get(sources[i], "path");
+				sheet.sources.push_back({ sourceId.toString().toStdString(), path.toString().toStdString() });
+			}
+			const auto &eventInfos = get(json, "eventInfos");
+			for (int i = 0; i < eventInfos.size(); ++i)
+			{
+				const auto &sheetEventInfos = get(eventInfos[i], "sheetEventInfos");
+				for (int j = 0; j < sheetEventInfos.size(); ++j)
+				{
+					DocumentEventInfo eventInfo;
+					const auto &sheetEventInfo = sheetEventInfos[j];
+					eventInfo.sourceId = (unsigned)(juce::int64)get(sheetEventInfo, "sourceId");
+					eventInfo.beginPosition = (int)(juce::int64)get(sheetEventInfo, "beginPosition");
+					const auto &endPosition = get(sheetEventInfo, "endPosition", false);
+					if (!endPosition.isVoid())
+					{
+						eventInfo.endPosition = (int)(juce::int64)endPosition;
+					}
+					eventInfo.beginTime = (double)get(sheetEventInfo, "beginTime");
+					eventInfo.endTime = (double)get(sheetEventInfo, "endTime");
+					EventPositionSet value = { eventInfo };
+					sheet.eventInfos += std::make_pair(TimelineIntervalType::right_open(eventInfo.beginTime, eventInfo.endTime), value);
+				}
+			}
+		}
+		catch (const std::exception &ex)
+		{
+			outcome.failed = true;
+			outcome.message = ex.what();
+		}
+		return outcome;
+	}
+
+	/// `chunkSize` 0 splits the document once at `splitOffset`
+	Outcome parseStreaming(const std::string &document, size_t splitOffset, size_t chunkSize)
+	{
+		Outcome outcome;
+		try
+		{
+			CompilerOutputParser parser(outcome.sheet);
+			if (chunkSize == 0)
+			{
+				parser.feed(document.data(), splitOffset);
+				parser.feed(document.data() + splitOffset, document.size() - splitOffset);
+			}
+			else
+			{
+				for (size_t offset = 0; offset < document.size(); offset += chunkSize)
+				{
+					parser.feed(document.data() + offset, std::min(chunkSize, document.size() - offset));
+				}
+			}
+			parser.finish();
+			if (parser.hasError())
+			{
+				outcome.failed = true;
+				outcome.isCompilerError = true;
+				outcome.message = parser.getErrorMessage();
+			}
+			else if (!parser.isComplete())
+			{
+				throw std::runtime_error(UnexpectedResponse);
+			}
+		}
+		catch (const std::exception &ex)
+		{
+			outcome.failed = true;
+			outcome.message = ex.what();
+		}
+		return outcome;
+	}
+
+	juce::String fromUTF8(const std::string &text)
+	{
+		return juce::String::fromUTF8(text.data(), (int)text.size());
+	}
+
+	/// depending on the juce version, juce::JSON encodes both halves of a surrogate pair
+	/// as utf-8 of their own; they are joined into one code point before comparing
+	std::string joinSurrogateHalves(const std::string &text)
+	{
+		std::string result;
+		for (size_t i = 0; i < text.size(); ++i)
+		{
+			auto byte = [&text](size_t index) { return (unsigned char)text[index]; };
+			bool isPair = i + 6 <= text.size()
+				&& byte(i) == 0xED && (byte(i + 1) & 0xF0) == 0xA0
+				&& byte(i + 3) == 0xED && (byte(i + 4) & 0xF0) == 0xB0;
+			if (!isPair)
+			{
+				result += text[i];
+				continue;
+			}
+			unsigned high = 0xD000 | ((byte(i + 1) & 0x3Fu) << 6) | (byte(i + 2) & 0x3Fu);
+			unsigned low = 0xD000 | ((byte(i + 4) & 0x3Fu) << 6) | (byte(i + 5) & 0x3Fu);
+			unsigned codePoint = 0x10000 + ((high - 0xD800) << 10) + (low - 0xDC00);
+			result += (char)(0xF0 | (codePoint >> 18));
+			result += (char)(0x80 | ((codePoint >> 12) & 0x3F));
+			result += (char)(0x80 | ((codePoint >> 6) & 0x3F));
+			result += (char)(0x80 | (codePoint & 0x3F));
+			i += 5;
+		}
+		return result;
+	}
+}
+
+/**
+ * Feeds compiler documents to CompilerOutputParser split at every byte offset
+ * and byte by byte, and compares the sheets with the ones the former
+ * juce::JSON path built from the same document.
+ */
+class CompilerOutputParserTest : public juce::UnitTest
+{
+public:
+	CompilerOutputParserTest() : juce::UnitTest("CompilerOutputParser", "Werckmeister") {}
+	void runTest() override
+	{
+		for (auto fileName : { "compiler-output.json", "compiler-error.json" })
+		{
+			auto file = juce::File(WM_TEST_DATA_DIRECTORY).getChildFile(fileName);
+			juce::MemoryBlock content;
+			file.loadFileAsData(content);
+			std::string document((const char*)content.getData(), content.getSize());
+			beginTest(fileName);
+			expect(!document.empty(), "could not read " + file.getFullPathName());
+			testDocument(document);
+			// the same document cut short must fail on both paths
+			beginTest(juce::String(fileName) + " cut short");
+			testDocument(document.substr(0, document.size() / 2));
+		}
+	}
+private:
+	void testDocument(const std::string &document)
+	{
+		auto expected = parseWithJuceJson(document);
+		for (size_t offset = 0; offset <= document.size(); ++offset)
+		{
+			expectSameOutcome(expected, parseStreaming(document, offset, 0), "split at " + juce::String((juce::int64)offset));
+		}
+		expectSameOutcome(expected, parseStreaming(document, 0, 1), "byte by byte");
+	}
+
+	void expectSameOutcome(const Outcome &expected, const Outcome &actual, const juce::String &how)
+	{
+		expectEquals(actual.failed, expected.failed, how + ": " + fromUTF8(actual.message));
+		expectEquals(actual.isCompilerError, expected.isCompilerError, how);
+		if (expected.isCompilerError)
+		{
+			expectEquals(fromUTF8(actual.message), fromUTF8(joinSurrogateHalves(expected.message)), how);
+		}
+		if (expected.failed || actual.failed)
+		{
+			return;
+		}
+		const auto &expectedSheet = expected.sheet;
+		const auto &actualSheet = actual.sheet;
+		expectEquals(actualSheet.sources.size(), expectedSheet.sources.size(), how);
+		for (size_t i = 0; i < std::min(expectedSheet.sources.size(), actualSheet.sources.size()); ++i)
+		{
+			const auto &source = expectedSheet.sources[i];
+			expectEquals(fromUTF8(actualSheet.sources[i].sourceId), fromUTF8(source.sourceId), how);
+			expectEquals(fromUTF8(actualSheet.sources[i].path), fromUTF8(joinSurrogateHalves(source.path)), how);
+		}
+		expect(actualSheet.midiData == expectedSheet.midiData, how + ": midi data");
+		expectEquals(actualSheet.eventInfos.iterative_size(), expectedSheet.eventInfos.iterative_size(), how);
+		if (actualSheet.eventInfos.iterative_size() != expectedSheet.eventInfos.iterative_size())
+		{
+			return;
+		}
+		for (auto itExpected = expectedSheet.eventInfos.begin(), itActual = actualSheet.eventInfos.begin();
+			itExpected != expectedSheet.eventInfos.end(); ++itExpected, ++itActual)
+		{
+			expectWithinAbsoluteError(itActual->first.lower(), itExpected->first.lower(), MaxTimeError, how);
+			expectWithinAbsoluteError(itActual->first.upper(), itExpected->first.upper(), MaxTimeError, how);
+			expectEquals(itActual->second.size(), itExpected->second.size(), how);
+			if (itActual->second.size() != itExpected->second.size())
+			{
+				continue;
+			}
+			for (auto infoExpected = itExpected->second.begin(), infoActual = itActual->second.begin();
+				infoExpected != itExpected->second.end(); ++infoExpected, ++infoActual)
+			{
+				expectEquals(infoActual->sourceId, infoExpected->sourceId, how);
+				expectEquals(infoActual->beginPosition, infoExpected->beginPosition, how);
+				expectEquals(infoActual->endPosition, infoExpected->endPosition, how);
+				expectWithinAbsoluteError(infoActual->beginTime, infoExpected->beginTime, MaxTimeError, how);
+				expectWithinAbsoluteError(infoActual->endTime, infoExpected->endTime, MaxTimeError, how);
+			}
+		}
+	}
+};
+
+static CompilerOutputParserTest compilerOutputParserTest;
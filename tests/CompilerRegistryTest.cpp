@@ -0,0 +1,57 @@
+#include "CompilerRegistry.h"
+#include <juce_core/juce_core.h>
+
+namespace
+{
+	const char * HelpWithOutput =
+		"Allowed options:\n"
+		"  --help                produce help message\n"
+		"  --input arg           input file\n"
+		"  --mode arg            mode: normal, json or validate\n"
+		"  --output arg          output file\n"
+		"  --version             prints the version\n";
+
+	const char * HelpWithoutOutput =
+		"Allowed options:\n"
+		"  --help                produce help message\n"
+		"  --input arg           input file\n"
+		"  --mode arg            mode: normal, json or validate\n"
+		"  --output-format arg   midi or json\n"
+		"  --version             prints the version\n";
+}
+
+class CompilerRegistryTest : public juce::UnitTest
+{
+public:
+	CompilerRegistryTest() : juce::UnitTest("CompilerRegistry", "Werckmeister") {}
+	void runTest() override
+	{
+		beginTest("help text");
+		expect(CompilerRegistry::mentionsOutputOption(HelpWithOutput));
+		expect(!CompilerRegistry::mentionsOutputOption(HelpWithoutOutput), "--output-format is another option");
+		expect(CompilerRegistry::mentionsOutputOption("usage: sheetc [--output=<file>]"));
+		expect(CompilerRegistry::mentionsOutputOption("--output"));
+		expect(!CompilerRegistry::mentionsOutputOption(""));
+#if !JUCE_WINDOWS
+		beginTest("probing a compiler");
+		expect(supportsOutputOption(HelpWithOutput, false));
+		expect(supportsOutputOption(HelpWithOutput, true), "help on stderr");
+		expect(!supportsOutputOption(HelpWithoutOutput, false));
+		expect(!CompilerRegistry::supportsOutputOption("/nonexistent/sheetc"));
+#endif
+	}
+private:
+	/// runs a stand-in compiler script which prints `helpText` for --help
+	bool supportsOutputOption(const char *helpText, bool toErrorOutput)
+	{
+		auto script = juce::File::getSpecialLocation(juce::File::tempDirectory).getNonexistentChildFile("sheetc", ".sh");
+		juce::String redirect = toErrorOutput ? " >&2" : "";
+		script.replaceWithText("#!/bin/sh\ncat <<'EOF'" + redirect + "\n" + juce::String(helpText) + "EOF\n");
+		script.setExecutePermission(true);
+		auto result = CompilerRegistry::supportsOutputOption(script.getFullPathName().toStdString());
+		script.deleteFile();
+		return result;
+	}
+};
+
+static CompilerRegistryTest compilerRegistryTest;
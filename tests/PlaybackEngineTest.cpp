@@ -0,0 +1,108 @@
+#include "PlaybackEngine.h"
+#include <juce_audio_basics/juce_audio_basics.h>
+
+namespace
+{
+	const int TicksPerQuarterNote = 960;
+	const int NoteNumber = 60;
+	const int BlockSize = 512;
+
+	/// one note from the first to the fifth quarter
+	PlaybackSnapshotPtr createLongNoteSnapshot()
+	{
+		juce::MidiMessageSequence sequence;
+		sequence.addEvent(juce::MidiMessage::noteOn(1, NoteNumber, (juce::uint8)100), 0);
+		sequence.addEvent(juce::MidiMessage::noteOff(1, NoteNumber), 4 * TicksPerQuarterNote);
+		juce::MidiFile midiFile;
+		midiFile.setTicksPerQuarterNote(TicksPerQuarterNote);
+		midiFile.addTrack(sequence);
+		juce::MemoryOutputStream stream;
+		midiFile.writeTo(stream);
+		auto sheet = std::make_shared<CompiledSheet>();
+		auto data = (const unsigned char*)stream.getData();
+		sheet->midiData.assign(data, data + stream.getDataSize());
+		return createPlaybackSnapshot(sheet, {});
+	}
+
+	/// blocks of 120 bpm at 48 kHz, `blockIndex` counts from the given ppq position on
+	PlaybackEngine::Block createBlock(double ppqBegin, int blockIndex)
+	{
+		PlaybackEngine::Block block;
+		block.sampleRate = 48000;
+		block.bpm = 120;
+		block.numSamples = BlockSize;
+		block.beginSample = (PlaybackEngine::SamplePosition)blockIndex * BlockSize;
+		block.ppqPosition = ppqBegin + blockIndex * BlockSize * block.bpm / (60.0 * block.sampleRate);
+		return block;
+	}
+
+	int countEvents(const juce::MidiBuffer &buffer, bool noteOns)
+	{
+		int result = 0;
+		for (const auto metadata : buffer)
+		{
+			auto message = metadata.getMessage();
+			if (message.getNoteNumber() == NoteNumber && (noteOns ? message.isNoteOn() : message.isNoteOff()))
+			{
+				++result;
+			}
+		}
+		return result;
+	}
+}
+
+class PlaybackEngineTest : public juce::UnitTest
+{
+public:
+	PlaybackEngineTest() : juce::UnitTest("PlaybackEngine", "Werckmeister") {}
+	void runTest() override
+	{
+		beginTest("starting inside a note chases it");
+		{
+			auto snapshot = createLongNoteSnapshot();
+			PlaybackEngine engine;
+			engine.setSnapshot(snapshot.get());
+			juce::MidiBuffer midiMessages;
+			engine.renderBlock(createBlock(1.0, 0), midiMessages);
+			expectEquals(countEvents(midiMessages, true), 1);
+			midiMessages.clear();
+			engine.renderBlock(createBlock(1.0, 1), midiMessages);
+			expectEquals(countEvents(midiMessages, true), 0, "a continuous block does not chase again");
+		}
+		beginTest("stop and play at the same position chases again");
+		{
+			auto snapshot = createLongNoteSnapshot();
+			PlaybackEngine engine;
+			engine.setSnapshot(snapshot.get());
+			juce::MidiBuffer midiMessages;
+			engine.renderBlock(createBlock(1.0, 0), midiMessages);
+			midiMessages.clear();
+			// the host stops: the processor releases everything, the playhead stays
+			engine.sendAllNoteOff(midiMessages);
+			expectEquals(countEvents(midiMessages, false), 1);
+			midiMessages.clear();
+			engine.renderBlock(createBlock(1.0, 1), midiMessages);
+			expectEquals(countEvents(midiMessages, true), 1);
+			expectEquals(countEvents(midiMessages, false), 0);
+		}
+		beginTest("a tempo change within a block is not a jump");
+		{
+			auto snapshot = createLongNoteSnapshot();
+			PlaybackEngine engine;
+			engine.setSnapshot(snapshot.get());
+			juce::MidiBuffer midiMessages;
+			auto block = createBlock(1.0, 0);
+			engine.renderBlock(block, midiMessages);
+			midiMessages.clear();
+			// the host ramped from 120 to 60 bpm during the first block, so it is behind the projection
+			auto next = createBlock(1.0, 1);
+			next.bpm = 60;
+			next.ppqPosition = block.ppqPosition + BlockSize * 90.0 / (60.0 * block.sampleRate);
+			engine.renderBlock(next, midiMessages);
+			expectEquals(countEvents(midiMessages, false), 0, "no all notes off");
+			expectEquals(countEvents(midiMessages, true), 0, "no chase");
+		}
+	}
+};
+
+static PlaybackEngineTest playbackEngineTest;
@@ -0,0 +1,18 @@
+#include <juce_core/juce_core.h>
+
+/**
+ * Runs every juce::UnitTest of the category "Werckmeister",
+ * the exit code is the number of failed expectations.
+ */
+int main(int, char*[])
+{
+	juce::UnitTestRunner runner;
+	runner.setAssertOnFailure(false);
+	runner.runTestsInCategory("Werckmeister");
+	int numFailures = 0;
+	for (int i = 0; i < runner.getNumResults(); ++i)
+	{
+		numFailures += runner.getResult(i)->failures;
+	}
+	return numFailures;
+}
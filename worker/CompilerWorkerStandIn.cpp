@@ -0,0 +1,83 @@
+#include <juce_core/juce_core.h>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#if JUCE_WINDOWS
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+/**
+ * Answers compile requests framed as described in WorkerCompilerBackend
+ * by running the one-shot compiler for each of them.
+ * It keeps nothing warm, it is there to try the protocol and the
+ * plugin side of it without a compiler that has a worker mode.
+ * Usage: CompilerWorkerStandIn <compiler executable>
+ * To use it set `compilerWorkerPath` in the plugin preferences.
+ */
+namespace
+{
+	const size_t MaxFrameHeaderSize = 20;
+
+	bool readFrame(std::string &payload)
+	{
+		size_t size = 0;
+		int ch = 0;
+		for (size_t i = 0; (ch = std::getchar()) != '\n'; ++i)
+		{
+			if (ch == EOF || ch < '0' || ch > '9' || i > MaxFrameHeaderSize)
+			{
+				return false;
+			}
+			size = size * 10 + (size_t)(ch - '0');
+		}
+		payload.resize(size);
+		return size == 0 || std::fread(&payload[0], 1, size, stdin) == size;
+	}
+
+	void writeFrame(const std::string &payload)
+	{
+		auto header = std::to_string(payload.size()) + "\n";
+		std::fwrite(header.data(), 1, header.size(), stdout);
+		std::fwrite(payload.data(), 1, payload.size(), stdout);
+		std::fflush(stdout);
+	}
+
+	std::string compile(const juce::String &compilerExecutable, const juce::var &request)
+	{
+		juce::StringArray commandLine;
+		commandLine.add(compilerExecutable);
+		commandLine.add(request["sheetPath"].toString());
+		commandLine.add("--mode=json");
+		if (request.hasProperty("output"))
+		{
+			commandLine.add("--output=" + request["output"].toString());
+		}
+		juce::ChildProcess compiler;
+		if (!compiler.start(commandLine, juce::ChildProcess::wantStdOut))
+		{
+			return "{\"errorMessage\": \"the stand-in could not start the compiler\"}";
+		}
+		return compiler.readAllProcessOutput().toStdString();
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		std::cerr << "usage: CompilerWorkerStandIn <compiler executable>" << std::endl;
+		return 1;
+	}
+#if JUCE_WINDOWS
+	_setmode(_fileno(stdin), _O_BINARY);
+	_setmode(_fileno(stdout), _O_BINARY);
+#endif
+	juce::String compilerExecutable(argv[1]);
+	std::string payload;
+	while (readFrame(payload))
+	{
+		writeFrame(compile(compilerExecutable, juce::JSON::parse(juce::String(payload))));
+	}
+	return 0;
+}